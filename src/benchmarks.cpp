@@ -0,0 +1,301 @@
+// LoadObj is only compared against here, so its implementation is compiled in this file, once: the headers below
+// include tiny_obj_loader.h again by other paths.
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "../ext/tiny_obj_loader.h"
+#undef TINYOBJLOADER_IMPLEMENTATION
+
+#include "benchmarks.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <random>
+#include "clipper.h"
+#include "graphics.h"
+#include "mat4.h"
+#include "mesh.h"
+#include "obj_parser.h"
+#include "object.h"
+#include "thread_pool.h"
+#include "world.h"
+
+namespace
+{
+    // Runs of each parser per file; the fastest is reported, to leave out the first run's page faults.
+    constexpr int PARSE_RUNS = 3;
+    constexpr int TEAPOT_COPIES = 64;
+    constexpr size_t GRID_TRIANGLES = 10000000;
+    constexpr int CULL_FRAMES = 20;
+    constexpr int PICKS_PER_FRAME = 100;
+
+    double milliseconds_since(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void write_face_corner(FILE* file, const tinyobj::index_t& index, int v_offset, int vt_offset, int vn_offset)
+    {
+        std::fprintf(file, " %d", index.vertex_index + 1 + v_offset);
+        if (index.texcoord_index < 0 && index.normal_index < 0) return;
+        std::fputc('/', file);
+        if (index.texcoord_index >= 0) std::fprintf(file, "%d", index.texcoord_index + 1 + vt_offset);
+        if (index.normal_index >= 0) std::fprintf(file, "/%d", index.normal_index + 1 + vn_offset);
+    }
+
+    // Copies of the model side by side, each with its own vertices and faces, so that indices run up to copies times
+    // as high as in the model.
+    bool write_repeated_obj(const std::string& source, const std::string& path, int copies)
+    {
+        tinyobj::attrib_t attrib;
+        tinyobj::shape_t shape;
+        if (!parse_obj_parallel(source, ThreadPool::shared(), attrib, shape)) return false;
+
+        FILE* file = std::fopen(path.c_str(), "wb");
+        if (file == nullptr) return false;
+
+        int v_count = (int) attrib.vertices.size() / 3;
+        int vt_count = (int) attrib.texcoords.size() / 2;
+        int vn_count = (int) attrib.normals.size() / 3;
+        for (int c = 0; c < copies; c++)
+        {
+            float shift = 100.0f * c;
+            for (int v = 0; v < v_count; v++)
+            {
+                std::fprintf(file, "v %f %f %f\n", attrib.vertices[3 * v] + shift, attrib.vertices[3 * v + 1], attrib.vertices[3 * v + 2]);
+            }
+            for (int vt = 0; vt < vt_count; vt++)
+            {
+                std::fprintf(file, "vt %f %f\n", attrib.texcoords[2 * vt], attrib.texcoords[2 * vt + 1]);
+            }
+            for (int vn = 0; vn < vn_count; vn++)
+            {
+                std::fprintf(file, "vn %f %f %f\n", attrib.normals[3 * vn], attrib.normals[3 * vn + 1], attrib.normals[3 * vn + 2]);
+            }
+            for (size_t i = 0; i < shape.mesh.indices.size(); i += 3)
+            {
+                std::fputc('f', file);
+                for (size_t k = 0; k < 3; k++)
+                {
+                    write_face_corner(file, shape.mesh.indices[i + k], c * v_count, c * vt_count, c * vn_count);
+                }
+                std::fputc('\n', file);
+            }
+        }
+        return std::fclose(file) == 0;
+    }
+
+    // A flat square grid of about the given number of triangles, with uvs and a single normal.
+    bool write_grid_obj(const std::string& path, size_t triangles)
+    {
+        FILE* file = std::fopen(path.c_str(), "wb");
+        if (file == nullptr) return false;
+
+        int side = (int) std::ceil(std::sqrt(triangles / 2.0));
+        for (int y = 0; y <= side; y++)
+        {
+            for (int x = 0; x <= side; x++)
+            {
+                float u = (float) x / side;
+                float v = (float) y / side;
+                std::fprintf(file, "v %f 0 %f\nvt %f %f\n", u * 2 - 1, v * 2 - 1, u, v);
+            }
+        }
+        std::fprintf(file, "vn 0 1 0\n");
+        for (int y = 0; y < side; y++)
+        {
+            for (int x = 0; x < side; x++)
+            {
+                int a = y * (side + 1) + x + 1;
+                int b = a + 1;
+                int c = a + side + 1;
+                int d = c + 1;
+                std::fprintf(file, "f %d/%d/1 %d/%d/1 %d/%d/1\nf %d/%d/1 %d/%d/1 %d/%d/1\n", a, a, c, c, b, b, b, b, c, c, d, d);
+            }
+        }
+        return std::fclose(file) == 0;
+    }
+
+    template <typename T>
+    bool same_data(const std::vector<T>& a, const std::vector<T>& b)
+    {
+        return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+    }
+
+    bool benchmark_parse(const std::string& path)
+    {
+        double parallel_ms = 1e30;
+        tinyobj::attrib_t attrib;
+        tinyobj::shape_t shape;
+        for (int run = 0; run < PARSE_RUNS; run++)
+        {
+            attrib = tinyobj::attrib_t();
+            shape = tinyobj::shape_t();
+            auto start = std::chrono::steady_clock::now();
+            if (!parse_obj_parallel(path, ThreadPool::shared(), attrib, shape))
+            {
+                std::cerr << "Error: could not read " << path << std::endl;
+                return false;
+            }
+            parallel_ms = std::min(parallel_ms, milliseconds_since(start));
+        }
+
+        double tinyobj_ms = 1e30;
+        tinyobj::attrib_t tinyobj_attrib;
+        std::vector<tinyobj::shape_t> tinyobj_shapes;
+        for (int run = 0; run < PARSE_RUNS; run++)
+        {
+            tinyobj_attrib = tinyobj::attrib_t();
+            tinyobj_shapes.clear();
+            std::vector<tinyobj::material_t> materials;
+            std::string warnings;
+            auto start = std::chrono::steady_clock::now();
+            tinyobj::LoadObj(&tinyobj_attrib, &tinyobj_shapes, &materials, &warnings, path.c_str());
+            tinyobj_ms = std::min(tinyobj_ms, milliseconds_since(start));
+        }
+
+        // parse_obj_parallel puts every face into one shape.
+        std::vector<tinyobj::index_t> tinyobj_indices;
+        for (const tinyobj::shape_t& s : tinyobj_shapes)
+        {
+            tinyobj_indices.insert(tinyobj_indices.end(), s.mesh.indices.begin(), s.mesh.indices.end());
+        }
+        bool identical = same_data(attrib.vertices, tinyobj_attrib.vertices) && same_data(attrib.normals, tinyobj_attrib.normals) &&
+                         same_data(attrib.texcoords, tinyobj_attrib.texcoords) && same_data(shape.mesh.indices, tinyobj_indices);
+
+        std::printf("%s: %zu triangles, %.1f MB\n", path.c_str(), shape.mesh.indices.size() / 3,
+                    std::filesystem::file_size(path) / (1024.0 * 1024.0));
+        std::printf("  parse_obj_parallel %.1f ms, tinyobj::LoadObj %.1f ms (%.2fx), %s\n", parallel_ms, tinyobj_ms,
+                    tinyobj_ms / parallel_ms, identical ? "identical" : "DIFFERENT");
+        return identical;
+    }
+
+    // Culls the spheres of the given objects against the frustum, the way the renderer does after its BVH query, and
+    // returns how many are visible.
+    size_t count_visible(const std::vector<Object*>& objects, const FrustumPlanes& frustum)
+    {
+        size_t count = objects.size();
+        std::vector<float> x(count), y(count), z(count), radius(count);
+        std::vector<uint8_t> visible(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            BoundingSphere sphere = objects[i]->getWorldBoundingSphere();
+            x[i] = sphere.center.x;
+            y[i] = sphere.center.y;
+            z[i] = sphere.center.z;
+            radius[i] = sphere.radius;
+        }
+        return count - cull_spheres(frustum, x.data(), y.data(), z.data(), radius.data(), count, visible.data());
+    }
+
+    void benchmark_cull(const std::shared_ptr<Mesh>& mesh, int object_count)
+    {
+        // The scene grows with the object count, so that about as many objects fall in view each time.
+        float extent = 20.0f * std::cbrt(object_count / 1000.0f);
+        std::mt19937 random(1);
+        std::uniform_real_distribution<float> position(-extent, extent);
+
+        std::vector<std::unique_ptr<Object>> objects;
+        objects.reserve(object_count);
+        World world;
+        auto build_start = std::chrono::steady_clock::now();
+        for (int i = 0; i < object_count; i++)
+        {
+            mat4 transform = makeTranslation(position(random), position(random) * 0.2f, position(random)) * makeScale(0.1, 0.1, 0.1);
+            objects.push_back(std::make_unique<Object>(mesh, std::make_unique<mat4>(transform)));
+            world.addObject(objects.back().get());
+        }
+        double build_ms = milliseconds_since(build_start);
+
+        std::uniform_int_distribution<int> moved(0, object_count - 1);
+        std::uniform_real_distribution<float> nudge(-0.05f, 0.05f);
+        double bvh_ms = 0, linear_ms = 0, update_ms = 0, pick_ms = 0;
+        size_t bvh_visible = 0, linear_visible = 0;
+        std::vector<Object*> candidates;
+        for (int frame = 0; frame < CULL_FRAMES; frame++)
+        {
+            // The camera turns in place in the middle of the scene.
+            float angle = frame * 0.9f;
+            vec3 eye(0, 0.5f, 0);
+            FrustumPlanes frustum = frustum_planes(perspective() * lookAt(eye, vec3(std::cos(angle), 0.5f, std::sin(angle))));
+
+            auto start = std::chrono::steady_clock::now();
+            candidates.clear();
+            world.queryObjects(frustum, eye, candidates);
+            bvh_visible += count_visible(candidates, frustum);
+            bvh_ms += milliseconds_since(start);
+
+            start = std::chrono::steady_clock::now();
+            linear_visible += count_visible(world.getObjects(), frustum);
+            linear_ms += milliseconds_since(start);
+
+            start = std::chrono::steady_clock::now();
+            for (int i = 0; i < object_count / 100; i++)
+            {
+                Object* object = objects[moved(random)].get();
+                mat4& transform = *object->getMat();
+                transform(0, 3) += nudge(random);
+                transform(2, 3) += nudge(random);
+                world.updateObject(object);
+            }
+            update_ms += milliseconds_since(start);
+
+            start = std::chrono::steady_clock::now();
+            for (int i = 0; i < PICKS_PER_FRAME; i++)
+            {
+                float distance;
+                float direction = i * 0.0628f;
+                world.pickObject(eye, vec3(std::cos(direction), -0.02f, std::sin(direction)), distance);
+            }
+            pick_ms += milliseconds_since(start);
+        }
+
+        std::printf("%8d objects: build %.1f ms, BVH height %d\n", object_count, build_ms, world.getBVH().height());
+        std::printf("  cull per frame: BVH %.3f ms, every object %.3f ms, %zu/%zu visible\n", bvh_ms / CULL_FRAMES,
+                    linear_ms / CULL_FRAMES, bvh_visible / CULL_FRAMES, linear_visible / CULL_FRAMES);
+        std::printf("  move 1%% per frame %.3f ms, pick %.1f us\n", update_ms / CULL_FRAMES,
+                    pick_ms * 1000.0 / (CULL_FRAMES * PICKS_PER_FRAME));
+    }
+}
+
+int run_parse_benchmark(const std::vector<std::string>& paths)
+{
+    std::printf("%d threads, fastest of %d runs\n", ThreadPool::shared().size(), PARSE_RUNS);
+    if (!paths.empty())
+    {
+        bool identical = true;
+        for (const std::string& path : paths)
+        {
+            identical = benchmark_parse(path) && identical;
+        }
+        return identical ? 0 : 1;
+    }
+
+    std::filesystem::path directory = std::filesystem::temp_directory_path();
+    std::string teapots = (directory / "3dsr_bench_teapots.obj").string();
+    std::string grid = (directory / "3dsr_bench_grid.obj").string();
+    if (!write_repeated_obj("obj/teapot.obj", teapots, TEAPOT_COPIES) || !write_grid_obj(grid, GRID_TRIANGLES))
+    {
+        std::cerr << "Error: could not write the benchmark files to " << directory << std::endl;
+        return 1;
+    }
+
+    bool identical = benchmark_parse(teapots);
+    identical = benchmark_parse(grid) && identical;
+    std::filesystem::remove(teapots);
+    std::filesystem::remove(grid);
+    return identical ? 0 : 1;
+}
+
+int run_cull_benchmark(int max_objects)
+{
+    auto mesh = std::make_shared<Mesh>("obj/monkey_flat.obj");
+    for (int object_count = 1000; object_count <= max_objects; object_count *= 10)
+    {
+        benchmark_cull(mesh, object_count);
+    }
+    return 0;
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <string>
+#include <vector>
+
+// Benchmarks run with "3DSR bench <name> [arguments]", which print their results and return the process exit code.
+
+// Parses each OBJ file with parse_obj_parallel and with tinyobj::LoadObj, and reports the fastest of a few runs of each
+// and whether they read the same data. Without files, it writes and parses two of its own in the temporary directory:
+// obj/teapot.obj repeated 64 times, and a grid of 10M triangles.
+int run_parse_benchmark(const std::vector<std::string>& paths);
+
+// Scatters 1k, 10k, 100k and so on up to max_objects copies of obj/monkey_flat.obj at the same density, and reports
+// for each count how long the world takes to build, to cull a frame through its BVH and through a pass over every
+// object, to move 1% of the objects, and to pick an object with a ray.
+int run_cull_benchmark(int max_objects);
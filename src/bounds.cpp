@@ -0,0 +1,30 @@
+#include "bounds.h"
+#include <algorithm>
+#include <cmath>
+
+AABB transform_bounds(const mat4& M, const AABB& box)
+{
+    vec3 old_center = box.center();
+    vec3 center = vec3(M * vec4(old_center.x, old_center.y, old_center.z, 1));
+    vec3 extent = box.extent();
+    vec3 new_extent;
+    for (int row = 0; row < 3; row++)
+    {
+        new_extent[row] = (std::fabs(M(row, 0)) * extent.x) + (std::fabs(M(row, 1)) * extent.y) + (std::fabs(M(row, 2)) * extent.z);
+    }
+
+    AABB result;
+    result.min = center - new_extent;
+    result.max = center + new_extent;
+    return result;
+}
+
+BoundingSphere transform_bounds(const mat4& M, const BoundingSphere& sphere)
+{
+    float scale = std::max({ vec3(M[0]).length(), vec3(M[1]).length(), vec3(M[2]).length() });
+
+    BoundingSphere result;
+    result.center = vec3(M * vec4(sphere.center.x, sphere.center.y, sphere.center.z, 1));
+    result.radius = sphere.radius * scale;
+    return result;
+}
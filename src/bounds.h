@@ -0,0 +1,29 @@
+#pragma once
+#include "vec3.h"
+#include "mat4.h"
+
+// Bounding volumes, for deciding cheaply that everything inside them can be skipped.
+
+// Axis-aligned bounding box.
+struct AABB
+{
+    vec3 min;
+    vec3 max;
+
+    vec3 center() const { return (min + max) * 0.5f; }
+    vec3 extent() const { return (max - min) * 0.5f; }
+};
+
+struct BoundingSphere
+{
+    vec3 center;
+    float radius = 0;
+};
+
+// The axis-aligned box around the transformed box (Arvo, "Transforming Axis-Aligned Bounding Boxes", Graphics Gems 1990):
+// the center is transformed as a point, and each new half extent is the old ones weighted by the absolute matrix row.
+AABB transform_bounds(const mat4& M, const AABB& box);
+
+// A sphere around the transformed sphere. Its radius is scaled by the longest of M's axes, so it stays conservative
+// under non-uniform scale.
+BoundingSphere transform_bounds(const mat4& M, const BoundingSphere& sphere);
@@ -0,0 +1,404 @@
+#include "bvh.h"
+#include "clipper.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+static AABB merge(const AABB& a, const AABB& b)
+{
+    AABB result;
+    result.min = vec3(std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y), std::min(a.min.z, b.min.z));
+    result.max = vec3(std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y), std::max(a.max.z, b.max.z));
+    return result;
+}
+
+// The cost of a node is how likely a random query is to reach it, which is proportional to its surface area.
+static float surface_area(const AABB& box)
+{
+    vec3 size = box.max - box.min;
+    return 2 * ((size.x * size.y) + (size.y * size.z) + (size.z * size.x));
+}
+
+static bool contains(const AABB& outer, const AABB& inner)
+{
+    return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z &&
+           inner.max.x <= outer.max.x && inner.max.y <= outer.max.y && inner.max.z <= outer.max.z;
+}
+
+static AABB fatten(const AABB& box)
+{
+    vec3 extent = box.extent();
+    float margin = BVH::FAT_MARGIN * std::max({ extent.x, extent.y, extent.z });
+    AABB result;
+    result.min = box.min - vec3(margin, margin, margin);
+    result.max = box.max + vec3(margin, margin, margin);
+    return result;
+}
+
+static float distance_squared(const AABB& box, const vec3& point)
+{
+    vec3 offset = box.center() - point;
+    return dot(offset, offset);
+}
+
+// Tests the box against the planes in plane_mask only, since the box's parent was already entirely inside the others.
+// Returns false if it lies entirely outside one of them; otherwise plane_mask keeps only the planes it straddles.
+static bool box_in_frustum(const AABB& box, const FrustumPlanes& frustum, int& plane_mask)
+{
+    vec3 center = box.center();
+    vec3 extent = box.extent();
+    int straddled = 0;
+    for (int p = 0; p < 6; p++)
+    {
+        if ((plane_mask & (1 << p)) == 0) continue;
+
+        const vec4& plane = frustum.planes[p];
+        float distance = (plane.x * center.x) + (plane.y * center.y) + (plane.z * center.z) + plane.w;
+        float radius = (std::fabs(plane.x) * extent.x) + (std::fabs(plane.y) * extent.y) + (std::fabs(plane.z) * extent.z);
+        if (distance + radius < 0) return false;
+        if (distance - radius < 0) straddled |= 1 << p;
+    }
+    plane_mask = straddled;
+    return true;
+}
+
+// Where the ray enters the box (slab test), clamped to 0 if it starts inside, or infinity if it misses it.
+static float ray_entry(const AABB& box, const vec3& origin, const vec3& inverse_direction, float max_distance)
+{
+    float entry = 0;
+    float exit = max_distance;
+    for (int k = 0; k < 3; k++)
+    {
+        float t0 = (box.min[k] - origin[k]) * inverse_direction[k];
+        float t1 = (box.max[k] - origin[k]) * inverse_direction[k];
+        if (t0 > t1) std::swap(t0, t1);
+        entry = std::max(entry, t0);
+        exit = std::min(exit, t1);
+    }
+    return entry <= exit ? entry : std::numeric_limits<float>::infinity();
+}
+
+int BVH::insert(const AABB& box, Object* object)
+{
+    int leaf = allocate_node();
+    nodes[leaf].box = fatten(box);
+    nodes[leaf].object = object;
+    insert_leaf(leaf);
+    leaf_count++;
+    return leaf;
+}
+
+void BVH::remove(int leaf)
+{
+    remove_leaf(leaf);
+    free_node(leaf);
+    leaf_count--;
+}
+
+bool BVH::update(int leaf, const AABB& box)
+{
+    if (contains(nodes[leaf].box, box)) return false;
+
+    remove_leaf(leaf);
+    nodes[leaf].box = fatten(box);
+    insert_leaf(leaf);
+    return true;
+}
+
+void BVH::clear()
+{
+    nodes.clear();
+    root = NO_NODE;
+    free_list = NO_NODE;
+    leaf_count = 0;
+}
+
+size_t BVH::size() const
+{
+    return leaf_count;
+}
+
+int BVH::height() const
+{
+    return root == NO_NODE ? 0 : nodes[root].height + 1;
+}
+
+int BVH::allocate_node()
+{
+    if (free_list == NO_NODE)
+    {
+        nodes.emplace_back();
+        return (int) nodes.size() - 1;
+    }
+
+    int node = free_list;
+    free_list = nodes[node].parent;
+    nodes[node] = Node();
+    return node;
+}
+
+void BVH::free_node(int node)
+{
+    nodes[node] = Node();
+    nodes[node].parent = free_list;
+    free_list = node;
+}
+
+// Finds the node that the box is cheapest to pair up with, as the best-first search of Catto ("Dynamic Bounding Volume
+// Hierarchies", GDC 2019). Pairing with a node costs the area of the new parent, plus the area that every ancestor
+// grows by to include the box, which only grows on the way down. So a subtree can be skipped as soon as the growth
+// inherited so far, plus the box's own area, is no better than the best candidate found.
+int BVH::find_sibling(const AABB& box)
+{
+    float box_area = surface_area(box);
+    int best = root;
+    float best_cost = surface_area(merge(nodes[root].box, box));
+
+    // A min-heap on the inherited cost, so that the most promising nodes are looked at first.
+    auto cheaper = [](const std::pair<float, int>& a, const std::pair<float, int>& b) { return a.first > b.first; };
+    sibling_queue.clear();
+    sibling_queue.emplace_back(0.0f, root);
+    while (!sibling_queue.empty())
+    {
+        std::pop_heap(sibling_queue.begin(), sibling_queue.end(), cheaper);
+        float inherited_cost = sibling_queue.back().first;
+        int node = sibling_queue.back().second;
+        sibling_queue.pop_back();
+        if (inherited_cost + box_area >= best_cost) break;
+
+        const Node& current = nodes[node];
+        float combined_area = surface_area(merge(current.box, box));
+        float cost = combined_area + inherited_cost;
+        if (cost < best_cost)
+        {
+            best = node;
+            best_cost = cost;
+        }
+
+        if (current.is_leaf()) continue;
+        float child_inherited_cost = inherited_cost + combined_area - surface_area(current.box);
+        if (child_inherited_cost + box_area >= best_cost) continue;
+
+        sibling_queue.emplace_back(child_inherited_cost, current.left);
+        std::push_heap(sibling_queue.begin(), sibling_queue.end(), cheaper);
+        sibling_queue.emplace_back(child_inherited_cost, current.right);
+        std::push_heap(sibling_queue.begin(), sibling_queue.end(), cheaper);
+    }
+    return best;
+}
+
+void BVH::insert_leaf(int leaf)
+{
+    if (root == NO_NODE)
+    {
+        root = leaf;
+        nodes[leaf].parent = NO_NODE;
+        return;
+    }
+
+    int sibling = find_sibling(nodes[leaf].box);
+    int old_parent = nodes[sibling].parent;
+    int new_parent = allocate_node();
+    nodes[new_parent].parent = old_parent;
+    nodes[new_parent].box = merge(nodes[sibling].box, nodes[leaf].box);
+    nodes[new_parent].height = nodes[sibling].height + 1;
+    nodes[new_parent].left = sibling;
+    nodes[new_parent].right = leaf;
+    nodes[sibling].parent = new_parent;
+    nodes[leaf].parent = new_parent;
+
+    if (old_parent == NO_NODE)
+    {
+        root = new_parent;
+    } else if (nodes[old_parent].left == sibling)
+    {
+        nodes[old_parent].left = new_parent;
+    } else
+    {
+        nodes[old_parent].right = new_parent;
+    }
+
+    refit_ancestors(old_parent);
+}
+
+// The leaf's sibling takes the place of their parent, which is freed. The leaf itself is left alone.
+void BVH::remove_leaf(int leaf)
+{
+    if (leaf == root)
+    {
+        root = NO_NODE;
+        return;
+    }
+
+    int parent = nodes[leaf].parent;
+    int grandparent = nodes[parent].parent;
+    int sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+    free_node(parent);
+    nodes[sibling].parent = grandparent;
+
+    if (grandparent == NO_NODE)
+    {
+        root = sibling;
+        return;
+    }
+
+    if (nodes[grandparent].left == parent)
+    {
+        nodes[grandparent].left = sibling;
+    } else
+    {
+        nodes[grandparent].right = sibling;
+    }
+    refit_ancestors(grandparent);
+}
+
+// Rebalances and recomputes the boxes and heights of node and everything above it, after a change below.
+void BVH::refit_ancestors(int node)
+{
+    while (node != NO_NODE)
+    {
+        node = balance(node);
+
+        Node& current = nodes[node];
+        const Node& left = nodes[current.left];
+        const Node& right = nodes[current.right];
+        current.height = 1 + std::max(left.height, right.height);
+        current.box = merge(left.box, right.box);
+        node = current.parent;
+    }
+}
+
+// If one child of the node is more than one level taller than the other, rotates that child up into the node's place,
+// and hands the shorter of its own children down to the node. Returns the node that now sits in the node's place.
+int BVH::balance(int a)
+{
+    if (nodes[a].is_leaf() || nodes[a].height < 2) return a;
+
+    int b = nodes[a].left;
+    int c = nodes[a].right;
+    int difference = nodes[c].height - nodes[b].height;
+    if (difference >= -1 && difference <= 1) return a;
+
+    // The taller child goes up, and its own taller child stays with it.
+    bool right_is_taller = difference > 0;
+    int up = right_is_taller ? c : b;
+    int stay = right_is_taller ? b : c;
+    int f = nodes[up].left;
+    int g = nodes[up].right;
+    int kept = nodes[f].height > nodes[g].height ? f : g;
+    int moved = kept == f ? g : f;
+
+    nodes[up].parent = nodes[a].parent;
+    nodes[a].parent = up;
+    if (nodes[up].parent == NO_NODE)
+    {
+        root = up;
+    } else if (nodes[nodes[up].parent].left == a)
+    {
+        nodes[nodes[up].parent].left = up;
+    } else
+    {
+        nodes[nodes[up].parent].right = up;
+    }
+
+    nodes[up].left = a;
+    nodes[up].right = kept;
+    if (right_is_taller)
+    {
+        nodes[a].right = moved;
+    } else
+    {
+        nodes[a].left = moved;
+    }
+    nodes[moved].parent = a;
+
+    nodes[a].box = merge(nodes[stay].box, nodes[moved].box);
+    nodes[a].height = 1 + std::max(nodes[stay].height, nodes[moved].height);
+    nodes[up].box = merge(nodes[a].box, nodes[kept].box);
+    nodes[up].height = 1 + std::max(nodes[a].height, nodes[kept].height);
+    return up;
+}
+
+void BVH::query(const FrustumPlanes& frustum, const vec3& eye, std::vector<Object*>& objects,
+                const std::function<bool(const AABB&)>& occluded) const
+{
+    if (root == NO_NODE) return;
+
+    // Each entry carries the planes its box still has to be tested against.
+    std::vector<std::pair<int, int>> stack;
+    stack.reserve(64);
+    stack.emplace_back(root, (1 << 6) - 1);
+    while (!stack.empty())
+    {
+        int node = stack.back().first;
+        int plane_mask = stack.back().second;
+        stack.pop_back();
+
+        const Node& current = nodes[node];
+        if (plane_mask != 0 && !box_in_frustum(current.box, frustum, plane_mask)) continue;
+        if (occluded && occluded(current.box)) continue;
+
+        if (current.is_leaf())
+        {
+            objects.push_back(current.object);
+            continue;
+        }
+
+        // The farther child goes on the stack first, so that the nearer one comes off it first.
+        int near_child = current.left;
+        int far_child = current.right;
+        if (distance_squared(nodes[far_child].box, eye) < distance_squared(nodes[near_child].box, eye))
+        {
+            std::swap(near_child, far_child);
+        }
+        stack.emplace_back(far_child, plane_mask);
+        stack.emplace_back(near_child, plane_mask);
+    }
+}
+
+Object* BVH::ray_cast(const vec3& origin, const vec3& direction, float max_distance,
+                      const std::function<float(Object*, float)>& hit, float& distance) const
+{
+    if (root == NO_NODE) return nullptr;
+
+    vec3 inverse_direction(1 / direction.x, 1 / direction.y, 1 / direction.z);
+    Object* nearest = nullptr;
+    float nearest_distance = max_distance;
+
+    // Each entry carries where the ray enters its box, so that boxes behind the nearest hit so far are skipped.
+    std::vector<std::pair<int, float>> stack;
+    stack.reserve(64);
+    float root_entry = ray_entry(nodes[root].box, origin, inverse_direction, max_distance);
+    if (root_entry <= max_distance) stack.emplace_back(root, root_entry);
+    while (!stack.empty())
+    {
+        int node = stack.back().first;
+        float entry = stack.back().second;
+        stack.pop_back();
+        if (entry > nearest_distance) continue;
+
+        const Node& current = nodes[node];
+        if (current.is_leaf())
+        {
+            float t = hit(current.object, nearest_distance);
+            if (t <= nearest_distance)
+            {
+                nearest = current.object;
+                nearest_distance = t;
+            }
+            continue;
+        }
+
+        float left_entry = ray_entry(nodes[current.left].box, origin, inverse_direction, nearest_distance);
+        float right_entry = ray_entry(nodes[current.right].box, origin, inverse_direction, nearest_distance);
+        std::pair<int, float> near_child(current.left, left_entry);
+        std::pair<int, float> far_child(current.right, right_entry);
+        if (right_entry < left_entry) std::swap(near_child, far_child);
+        if (far_child.second <= nearest_distance) stack.push_back(far_child);
+        if (near_child.second <= nearest_distance) stack.push_back(near_child);
+    }
+
+    if (nearest != nullptr) distance = nearest_distance;
+    return nearest;
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <functional>
+#include <utility>
+#include <vector>
+#include "bounds.h"
+
+class Object;
+struct FrustumPlanes;
+
+// A bounding volume hierarchy over objects that is kept up to date one object at a time, as a dynamic AABB tree
+// (as in Box2D and Bullet): every leaf holds one object, and every inner node the box around both of its children.
+//
+// Leaves store the object's box grown by a margin, so that an object that moves a little stays inside its leaf
+// and the tree doesn't change at all. Only once it leaves the grown box is the leaf taken out and inserted again.
+// New leaves go next to the sibling that grows the total surface area of the tree the least, and the tree is kept
+// balanced with AVL rotations, so queries stay logarithmic in the number of objects whatever order they come in.
+class BVH
+{
+    public:
+        // Leaves are grown by this fraction of the object's largest half extent on every side.
+        static constexpr float FAT_MARGIN = 0.25f;
+        static constexpr int NO_NODE = -1;
+
+        BVH() = default;
+
+        // Returns the leaf's id, which stays the same until the leaf is removed.
+        int insert(const AABB& box, Object* object);
+        void remove(int leaf);
+        // Moves the leaf to the object's new box, if it no longer fits in the grown one.
+        // Returns true if the tree had to change.
+        bool update(int leaf, const AABB& box);
+        void clear();
+
+        // Appends every object whose leaf box isn't entirely outside the frustum, roughly nearest to eye first.
+        // If occluded is given, it is asked about every node box inside the frustum, and the nodes it says are hidden
+        // are skipped with everything under them. Since nearer nodes are visited first, whatever they cover has been
+        // seen by the time the boxes behind them are asked about.
+        void query(const FrustumPlanes& frustum, const vec3& eye, std::vector<Object*>& objects,
+                   const std::function<bool(const AABB&)>& occluded = nullptr) const;
+
+        // Finds the nearest object along the ray origin + t * direction for t in [0, max_distance].
+        // Leaf boxes are visited in order of where the ray enters them, and hit(object, nearest_so_far) gives the exact
+        // distance at which the ray hits the object, or anything larger than nearest_so_far if it doesn't.
+        // Returns nullptr if nothing is hit; otherwise distance is set to where.
+        Object* ray_cast(const vec3& origin, const vec3& direction, float max_distance,
+                         const std::function<float(Object*, float)>& hit, float& distance) const;
+
+        size_t size() const;
+        // The number of nodes on the longest path from the root to a leaf, or 0 if the tree is empty.
+        int height() const;
+
+    private:
+        struct Node
+        {
+            AABB box;
+            int parent = NO_NODE; // The next free node instead, while this one is on the free list.
+            int left = NO_NODE;   // Leaves have no children.
+            int right = NO_NODE;
+            int height = 0;       // 0 for leaves.
+            Object* object = nullptr;
+
+            bool is_leaf() const { return left == NO_NODE; }
+        };
+
+        int allocate_node();
+        void free_node(int node);
+        void insert_leaf(int leaf);
+        void remove_leaf(int leaf);
+        int find_sibling(const AABB& box);
+        void refit_ancestors(int node);
+        int balance(int node);
+
+        std::vector<Node> nodes;
+        int root = NO_NODE;
+        int free_list = NO_NODE;
+        size_t leaf_count = 0;
+        std::vector<std::pair<float, int>> sibling_queue; // Scratch space for find_sibling.
+};
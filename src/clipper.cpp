@@ -0,0 +1,248 @@
+#include "clipper.h"
+#include <utility>
+
+// The planes a vertex can lie outside of. A point is inside a plane when its distance to it is positive.
+enum ClipPlane
+{
+    NEAR = 1 << 0,
+    FAR = 1 << 1,
+    LEFT = 1 << 2,
+    RIGHT = 1 << 3,
+    BOTTOM = 1 << 4,
+    TOP = 1 << 5,
+    GUARD_LEFT = 1 << 6,
+    GUARD_RIGHT = 1 << 7,
+    GUARD_BOTTOM = 1 << 8,
+    GUARD_TOP = 1 << 9
+};
+
+constexpr int FRUSTUM_PLANES = NEAR | FAR | LEFT | RIGHT | BOTTOM | TOP;
+constexpr int CLIPPING_PLANES = NEAR | FAR | GUARD_LEFT | GUARD_RIGHT | GUARD_BOTTOM | GUARD_TOP;
+
+// Signed distance (scaled by w) from the clip-space position to the plane.
+// The canonical view volume is -w <= x, y, z <= w; see perspective() in graphics.h.
+static float plane_distance(int plane, const vec4& p)
+{
+    switch (plane)
+    {
+    case NEAR:
+        return p.z + p.w;
+    case FAR:
+        return p.w - p.z;
+    case LEFT:
+        return p.x + p.w;
+    case RIGHT:
+        return p.w - p.x;
+    case BOTTOM:
+        return p.y + p.w;
+    case TOP:
+        return p.w - p.y;
+    case GUARD_LEFT:
+        return p.x + (GUARD_BAND * p.w);
+    case GUARD_RIGHT:
+        return (GUARD_BAND * p.w) - p.x;
+    case GUARD_BOTTOM:
+        return p.y + (GUARD_BAND * p.w);
+    default:
+        return (GUARD_BAND * p.w) - p.y;
+    }
+}
+
+int compute_outcode(const vec4& p)
+{
+    int code = 0;
+    for (int plane = NEAR; plane <= GUARD_TOP; plane <<= 1)
+    {
+        if (plane_distance(plane, p) < 0)
+        {
+            code |= plane;
+        }
+    }
+    return code;
+}
+
+ClipResult classify_triangle(int code0, int code1, int code2)
+{
+    // Every vertex is outside the same frustum plane, so nothing of the triangle can be visible.
+    if ((code0 & code1 & code2 & FRUSTUM_PLANES) != 0) return ClipResult::Culled;
+
+    if (((code0 | code1 | code2) & CLIPPING_PLANES) == 0) return ClipResult::Inside;
+
+    return ClipResult::Clipped;
+}
+
+bool outside_screen(int outcode)
+{
+    return (outcode & (LEFT | RIGHT | BOTTOM | TOP)) != 0;
+}
+
+// The point at distance t along the way from a to b, with its varyings interpolated the same way.
+// Varyings are linear in clip space, before the perspective divide, so a plain lerp is correct here.
+static ClipVertex lerp(const ClipVertex& a, const ClipVertex& b, float t)
+{
+    ClipVertex v;
+    v.position = a.position + ((b.position - a.position) * t);
+    for (int k = 0; k < Varyings::MAX_VARYINGS; k++)
+    {
+        v.varyings.v[k] = a.varyings.v[k] + ((b.varyings.v[k] - a.varyings.v[k]) * t);
+    }
+    return v;
+}
+
+// Sutherland-Hodgman: walk the polygon's edges and keep the part on the inner side of the plane.
+static int clip_polygon(int plane, const ClipVertex* in, int num_in, ClipVertex* out)
+{
+    int num_out = 0;
+    for (int i = 0; i < num_in; i++)
+    {
+        const ClipVertex& a = in[i];
+        const ClipVertex& b = in[(i + 1) % num_in];
+        float da = plane_distance(plane, a.position);
+        float db = plane_distance(plane, b.position);
+
+        if (da >= 0)
+        {
+            out[num_out++] = a;
+        }
+
+        // Always interpolate from the inside vertex towards the outside one, so that an edge shared by
+        // two triangles is split at exactly the same point for both, whichever direction they walk it in.
+        if (da >= 0 && db < 0)
+        {
+            out[num_out++] = lerp(a, b, da / (da - db));
+        } else if (da < 0 && db >= 0)
+        {
+            out[num_out++] = lerp(b, a, db / (db - da));
+        }
+    }
+    return num_out;
+}
+
+ClipResult clip_triangle(const ClipVertex (&triangle)[3], ClipVertex (&polygon)[MAX_CLIPPED_VERTICES], int& num_vertices)
+{
+    int code0 = compute_outcode(triangle[0].position);
+    int code1 = compute_outcode(triangle[1].position);
+    int code2 = compute_outcode(triangle[2].position);
+
+    ClipResult result = classify_triangle(code0, code1, code2);
+    if (result == ClipResult::Culled)
+    {
+        num_vertices = 0;
+        return result;
+    }
+
+    polygon[0] = triangle[0];
+    polygon[1] = triangle[1];
+    polygon[2] = triangle[2];
+    num_vertices = 3;
+    if (result == ClipResult::Inside) return result;
+
+    int planes = (code0 | code1 | code2) & CLIPPING_PLANES;
+
+    ClipVertex scratch[MAX_CLIPPED_VERTICES];
+    ClipVertex* in = polygon;
+    ClipVertex* out = scratch;
+    for (int plane = NEAR; plane <= GUARD_TOP && num_vertices > 0; plane <<= 1)
+    {
+        if ((planes & plane) == 0) continue;
+
+        num_vertices = clip_polygon(plane, in, num_vertices, out);
+        std::swap(in, out);
+    }
+
+    if (in != polygon)
+    {
+        for (int i = 0; i < num_vertices; i++)
+        {
+            polygon[i] = in[i];
+        }
+    }
+    return ClipResult::Clipped;
+}
+
+// Each clip-space plane, such as x + w >= 0 for the left one, is a combination of the rows of mvp (Gribb and Hartmann),
+// which gives the plane in the space mvp transforms from.
+FrustumPlanes frustum_planes(const mat4& mvp)
+{
+    vec4 rows[4];
+    for (int r = 0; r < 4; r++)
+    {
+        rows[r] = vec4(mvp(r, 0), mvp(r, 1), mvp(r, 2), mvp(r, 3));
+    }
+
+    FrustumPlanes frustum;
+    frustum.planes[0] = rows[3] + rows[2]; // Near
+    frustum.planes[1] = rows[3] - rows[2]; // Far
+    frustum.planes[2] = rows[3] + rows[0]; // Left
+    frustum.planes[3] = rows[3] - rows[0]; // Right
+    frustum.planes[4] = rows[3] + rows[1]; // Bottom
+    frustum.planes[5] = rows[3] - rows[1]; // Top
+
+    for (vec4& plane : frustum.planes)
+    {
+        float length = vec3(plane).length();
+        if (length > 0) plane = plane * (1.0f / length);
+    }
+    return frustum;
+}
+
+bool sphere_outside_frustum(const FrustumPlanes& frustum, const vec3& center, float radius)
+{
+    for (const vec4& plane : frustum.planes)
+    {
+        if ((plane.x * center.x) + (plane.y * center.y) + (plane.z * center.z) + plane.w < -radius) return true;
+    }
+    return false;
+}
+
+size_t cull_spheres(const FrustumPlanes& frustum, const float* x, const float* y, const float* z, const float* radius,
+                    size_t count, uint8_t* visible)
+{
+    size_t culled = 0;
+    size_t i = 0;
+#ifdef MATH_SIMD
+    // Four spheres at a time, one per lane, against each plane in turn. The distances are summed in the same order
+    // as in sphere_outside_frustum, so both agree on every sphere.
+    __m128 plane_x[6], plane_y[6], plane_z[6], plane_w[6];
+    for (int p = 0; p < 6; p++)
+    {
+        plane_x[p] = _mm_set1_ps(frustum.planes[p].x);
+        plane_y[p] = _mm_set1_ps(frustum.planes[p].y);
+        plane_z[p] = _mm_set1_ps(frustum.planes[p].z);
+        plane_w[p] = _mm_set1_ps(frustum.planes[p].w);
+    }
+    const __m128 sign = _mm_set1_ps(-0.0f);
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 cx = _mm_loadu_ps(x + i);
+        __m128 cy = _mm_loadu_ps(y + i);
+        __m128 cz = _mm_loadu_ps(z + i);
+        __m128 negative_radius = _mm_xor_ps(_mm_loadu_ps(radius + i), sign);
+
+        __m128 outside = _mm_setzero_ps();
+        for (int p = 0; p < 6; p++)
+        {
+            __m128 distance = _mm_mul_ps(plane_x[p], cx);
+            distance = _mm_add_ps(distance, _mm_mul_ps(plane_y[p], cy));
+            distance = _mm_add_ps(distance, _mm_mul_ps(plane_z[p], cz));
+            distance = _mm_add_ps(distance, plane_w[p]);
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negative_radius));
+        }
+
+        int mask = _mm_movemask_ps(outside);
+        for (int lane = 0; lane < 4; lane++)
+        {
+            bool lane_outside = ((mask >> lane) & 1) != 0;
+            visible[i + lane] = !lane_outside;
+            culled += lane_outside;
+        }
+    }
+#endif
+    for (; i < count; i++)
+    {
+        bool outside = sphere_outside_frustum(frustum, vec3(x[i], y[i], z[i]), radius[i]);
+        visible[i] = !outside;
+        culled += outside;
+    }
+    return culled;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "vec3.h"
+#include "vec4.h"
+#include "mat4.h"
+#include "shaders/shader.h"
+
+// A vertex in homogeneous clip space, along with the varyings the vertex stage produced for it.
+struct ClipVertex
+{
+    vec4 position;
+    Varyings varyings;
+};
+
+// Triangles reaching past the screen are only clipped in x and y once they leave this band, given in NDC units
+// (2 means the band extends one full screen past every edge). Inside it, the rasterizer's scissoring is cheaper
+// than clipping, and the fixed-point screen coordinates stay small enough for the 32-bit SIMD lanes.
+constexpr float GUARD_BAND = 2.0f;
+
+// Clipping a triangle against near, far and the four guard band planes adds at most one vertex per plane.
+constexpr int MAX_CLIPPED_VERTICES = 3 + 6;
+
+enum class ClipResult
+{
+    Culled,      // Entirely outside the view frustum.
+    Inside,      // Needs no clipping; may still reach past the screen into the guard band.
+    Clipped      // Replaced by a convex polygon.
+};
+
+// Bit mask of the planes (frustum and guard band) that a clip-space position lies outside of.
+// Triangles are classified from the outcodes of their corners, so these can be computed once per vertex.
+int compute_outcode(const vec4& position);
+
+// Whether a triangle with corners of the given outcodes is culled, can be drawn as is, or needs clipping.
+ClipResult classify_triangle(int code0, int code1, int code2);
+
+// True if the outcode says the position lies outside the screen in x or y.
+bool outside_screen(int outcode);
+
+// Clips a triangle against the near and far planes and the guard band, in homogeneous space.
+// The result is written to polygon as a triangle fan of num_vertices vertices, with interpolated varyings.
+// num_vertices can be 0 if clipping leaves nothing.
+ClipResult clip_triangle(const ClipVertex (&triangle)[3], ClipVertex (&polygon)[MAX_CLIPPED_VERTICES], int& num_vertices);
+
+
+// The 6 planes of the view frustum in the space that mvp transforms from, each as (normal, offset) with a unit normal
+// pointing inside, so that dot(normal, p) + offset is the distance of p from the plane.
+struct FrustumPlanes
+{
+    vec4 planes[6];
+};
+
+FrustumPlanes frustum_planes(const mat4& mvp);
+
+// True if the sphere lies entirely outside one of the planes. Spheres that only straddle a corner are kept.
+bool sphere_outside_frustum(const FrustumPlanes& frustum, const vec3& center, float radius);
+
+// Culls many spheres at once, given as separate arrays of center coordinates and radii: visible[i] is set to 0 if
+// sphere i lies entirely outside one of the planes, as in sphere_outside_frustum, and to 1 otherwise.
+// Returns the number of spheres culled.
+size_t cull_spheres(const FrustumPlanes& frustum, const float* x, const float* y, const float* z, const float* radius,
+                    size_t count, uint8_t* visible);
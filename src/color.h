@@ -1,7 +1,7 @@
-#pragma once
-
-class Color
-{
-    public:
-
-};
+#pragma once
+
+class Color
+{
+    public:
+
+};
@@ -0,0 +1,84 @@
+#include "depth_buffer.h"
+#include <algorithm>
+
+DepthBuffer::DepthBuffer(int width, int height)
+{
+    resize(width, height);
+}
+
+void DepthBuffer::resize(int width, int height)
+{
+    if (width == w && height == h) return;
+
+    w = width;
+    h = height;
+    depth.resize(w * h);
+
+    blocks_x = (w + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    blocks_y = (h + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    block_max.resize(blocks_x * blocks_y);
+}
+
+void DepthBuffer::clear()
+{
+    std::fill(depth.begin(), depth.end(), CLEAR_DEPTH);
+    std::fill(block_max.begin(), block_max.end(), CLEAR_DEPTH);
+}
+
+void DepthBuffer::clear(int min_x, int min_y, int max_x, int max_y)
+{
+    for (int y = min_y; y <= max_y; y++)
+    {
+        float* depth_row = row(y);
+        std::fill(depth_row + min_x, depth_row + max_x + 1, CLEAR_DEPTH);
+    }
+
+    for (int block_y = min_y / BLOCK_SIZE; block_y <= max_y / BLOCK_SIZE; block_y++)
+    {
+        float* block_row = block_max.data() + (block_y * blocks_x);
+        std::fill(block_row + (min_x / BLOCK_SIZE), block_row + (max_x / BLOCK_SIZE) + 1, CLEAR_DEPTH);
+    }
+}
+
+void DepthBuffer::update_block(int x, int y)
+{
+    int min_x = x - (x % BLOCK_SIZE);
+    int min_y = y - (y % BLOCK_SIZE);
+    int max_x = std::min(min_x + BLOCK_SIZE, w);
+    int max_y = std::min(min_y + BLOCK_SIZE, h);
+
+    float farthest = 0.0f;
+    for (int j = min_y; j < max_y; j++)
+    {
+        const float* depth_row = row(j);
+        for (int i = min_x; i < max_x; i++)
+        {
+            farthest = std::max(farthest, depth_row[i]);
+        }
+    }
+    block_max[((min_y / BLOCK_SIZE) * blocks_x) + (min_x / BLOCK_SIZE)] = farthest;
+}
+
+float DepthBuffer::max_depth(int min_x, int min_y, int max_x, int max_y) const
+{
+    float farthest = 0.0f;
+    for (int block_y = min_y / BLOCK_SIZE; block_y <= max_y / BLOCK_SIZE; block_y++)
+    {
+        const float* block_row = block_max.data() + (block_y * blocks_x);
+        for (int block_x = min_x / BLOCK_SIZE; block_x <= max_x / BLOCK_SIZE; block_x++)
+        {
+            farthest = std::max(farthest, block_row[block_x]);
+        }
+    }
+    return farthest;
+}
+
+int DepthBuffer::width() const
+{
+    return w;
+}
+
+int DepthBuffer::height() const
+{
+    return h;
+}
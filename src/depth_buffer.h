@@ -0,0 +1,62 @@
+#pragma once
+#include <limits>
+#include <vector>
+
+// The depth of the closest surface drawn so far at each pixel, stored as the interpolated w (smaller is closer).
+// Owned by the Renderer and kept across frames, so memory is only reallocated when the frame changes size.
+//
+// Alongside the pixels it keeps the farthest depth of every BLOCK_SIZE x BLOCK_SIZE block, so that a triangle
+// whose nearest point is behind a whole block can be rejected without testing its pixels one by one.
+// Depths only ever decrease between clears, so a block value that hasn't been updated yet is still a safe upper bound.
+class DepthBuffer
+{
+    public:
+        // The depth of a pixel that nothing has been drawn to yet.
+        static constexpr float CLEAR_DEPTH = std::numeric_limits<float>::max();
+        static constexpr int BLOCK_SIZE = 8;
+
+        DepthBuffer() = default;
+        DepthBuffer(int width, int height);
+
+        // Does nothing if the size stays the same. Otherwise the contents are undefined until the next clear.
+        void resize(int width, int height);
+
+        void clear();
+        // Clears only the pixels in [min_x, max_x] x [min_y, max_y], so that each tile can clear its own part.
+        // The blocks overlapping the area are reset too.
+        void clear(int min_x, int min_y, int max_x, int max_y);
+
+        // The farthest depth in the block containing pixel (x, y). Never closer than the pixels actually are.
+        float block_max_depth(int x, int y) const
+        {
+            return block_max[((y / BLOCK_SIZE) * blocks_x) + (x / BLOCK_SIZE)];
+        }
+
+        // Recomputes the farthest depth of the block containing pixel (x, y) from its pixels.
+        void update_block(int x, int y);
+
+        // The farthest depth over every block overlapping [min_x, max_x] x [min_y, max_y].
+        float max_depth(int min_x, int min_y, int max_x, int max_y) const;
+
+        float* row(int y)
+        {
+            return depth.data() + (y * w);
+        }
+
+        const float* row(int y) const
+        {
+            return depth.data() + (y * w);
+        }
+
+        int width() const;
+        int height() const;
+
+    private:
+        int w = 0;
+        int h = 0;
+        std::vector<float> depth;
+
+        int blocks_x = 0;
+        int blocks_y = 0;
+        std::vector<float> block_max;
+};
@@ -1,9 +0,0 @@
-#pragma once
-#include <vector>
-#include "vertex.h"
-
-class Face
-{
-    public:
-        std::vector<Vertex> vertices;
-};
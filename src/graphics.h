@@ -1,6 +1,10 @@
 #pragma once
+#include "frame.h"
+#include "mat4.h"
+#include "vec3.h"
+#include "vec4.h"
 
-static mat4 lookAt(vec3 eye, vec3 target, vec3 up = vec3(0,1,0))
+inline mat4 lookAt(vec3 eye, vec3 target, vec3 up = vec3(0,1,0))
 {
     // Translate eye position back to origin.
     // Our calculations assume that our eye is positioned at the origin and looks down the -Z axis.
@@ -31,8 +35,10 @@ static mat4 lookAt(vec3 eye, vec3 target, vec3 up = vec3(0,1,0))
 // NOTE: this transforms the coordinates into NDCS coordinates, which FLIPS the direction of our wn-axis, essentially
 // Our camera typically looks down the negative wn-axis but after transforming the coordinates it looks down the positive wn-axis.
 // This means your wn-buffer implementation needs to change: closer coordinates should be SMALLER, not LARGER
+// NOTE: the field of view only depends on n/t and n/r, and geometry in front of n gets clipped,
+// so keep n small and scale t and r with it.
 // Construct the perspective matrix.
-mat4 perspective(float t = 1.0f, float r = 1.0f, float n = 1.8f, float f = 10.0f)
+inline mat4 perspective(float t = 0.1f, float r = 0.1f, float n = 0.18f, float f = 10.0f)
 {
     float b = -t;
     float l = -r;
@@ -47,13 +53,16 @@ mat4 perspective(float t = 1.0f, float r = 1.0f, float n = 1.8f, float f = 10.0f
 }
 
 // Transforms the canonical cube (which ranges from [-1,-1,-1] to [1,1,1]) to range from [0,0,0] to [W,H,1].
-mat4 viewport(Frame& frame)
+inline mat4 viewport(const Frame& frame)
 {
+    float half_w = frame.w / 2.0f;
+    float half_h = frame.h / 2.0f;
+
     mat4 mat(   
-                    frame.w/2, 0,         0,   (frame.w)/2,
-                    0,         frame.h/2, 0,   (frame.h)/2,
-                    0,         0,         1/2, 1/2,
-                    0,         0,         0,   1
+                    half_w, 0,      0,    half_w,
+                    0,      half_h, 0,    half_h,
+                    0,      0,      0.5f, 0.5f,
+                    0,      0,      0,    1
             );
     return mat;
 }
\ No newline at end of file
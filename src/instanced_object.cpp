@@ -0,0 +1,41 @@
+#include "instanced_object.h"
+
+InstancedObject::InstancedObject(std::shared_ptr<Mesh> Mesh, std::vector<mat4> Transforms, std::vector<vec4> Parameters)
+    : mesh(std::move(Mesh)), transforms(std::move(Transforms)), parameters(std::move(Parameters))
+{
+}
+
+std::shared_ptr<Mesh>& InstancedObject::getMesh()
+{
+    return mesh;
+}
+
+std::vector<mat4>& InstancedObject::getTransforms()
+{
+    return transforms;
+}
+
+std::vector<vec4>& InstancedObject::getParameters()
+{
+    return parameters;
+}
+
+size_t InstancedObject::size() const
+{
+    return transforms.size();
+}
+
+const vec4& InstancedObject::getInstanceParameters(size_t i) const
+{
+    return i < parameters.size() ? parameters[i] : DEFAULT_PARAMETERS;
+}
+
+AABB InstancedObject::getInstanceBounds(size_t i) const
+{
+    return transform_bounds(transforms[i], mesh->getBounds());
+}
+
+BoundingSphere InstancedObject::getInstanceBoundingSphere(size_t i) const
+{
+    return transform_bounds(transforms[i], mesh->getBoundingSphere());
+}
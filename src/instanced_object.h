@@ -0,0 +1,37 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include "mesh.h"
+#include "mat4.h"
+#include "vec4.h"
+#include "bounds.h"
+
+// Many copies of one mesh, each with its own matrix and optionally its own parameters for the shader,
+// kept in contiguous arrays and drawn together in one go. Copies of a mesh that only differ in where they are
+// are cheaper to draw this way than as separate Objects: the mesh's data stays in cache from one copy to the next,
+// and everything that doesn't depend on the matrix is set up once for all of them.
+class InstancedObject
+{
+    public:
+        // The value of each copy's parameters if none are given.
+        static inline const vec4 DEFAULT_PARAMETERS = vec4(1, 1, 1, 1);
+
+        InstancedObject() = default;
+        // parameters is either empty or has one entry per transform.
+        InstancedObject(std::shared_ptr<Mesh> Mesh, std::vector<mat4> Transforms, std::vector<vec4> Parameters = {});
+
+        std::shared_ptr<Mesh>& getMesh();
+        // Can be changed freely between frames, as long as parameters keeps up with the number of transforms.
+        std::vector<mat4>& getTransforms();
+        std::vector<vec4>& getParameters();
+        size_t size() const;
+
+        // Of copy i: its parameters, or DEFAULT_PARAMETERS, and the mesh's bounds carried into world space.
+        const vec4& getInstanceParameters(size_t i) const;
+        AABB getInstanceBounds(size_t i) const;
+        BoundingSphere getInstanceBoundingSphere(size_t i) const;
+    private:
+        std::shared_ptr<Mesh> mesh = nullptr;
+        std::vector<mat4> transforms;
+        std::vector<vec4> parameters;
+};
@@ -1,121 +1,166 @@
-#include <iostream>
-#include <memory>
-#include <limits>
-#include <utility>
-#include <cmath>
-
-#include "vec2.h"
-#include "vec3.h"
-#include "vec4.h"
-#include "mat4.h"
-#include "frame.h"
-#include "object.h"
-#include "texture.h"
-#include "utils.h"
-#include "mesh.h"
-#include "world.h"
-#include "renderer.h"
-#include "shaders/gouraud_shader.h"
-#include "shaders/phong_shader.h"
-
-#define trace(var)  { std::cout << "Line " << __LINE__ << ": " << #var << "=" << var << "\n";}
-#include "SDL.h"
-
-const inline int WINDOW_WIDTH = 800;
-const inline int WINDOW_HEIGHT = 800;
-
-bool quit = false;
-
-#undef main // windows fix: unresolved external symbol https://stackoverflow.com/questions/4845410/error-lnk2019-unresolved-external-symbol-main-referenced-in-function-tmainc
-int main(int argc, char * argv[]) {
-    SDL_Event event;
-
-    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
-        SDL_Log("Unable to initialize SDL: %s", SDL_GetError());
-        return 1;
-    }
-
-    SDL_Window* window = SDL_CreateWindow("3DSR",
-                    SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-                    WINDOW_WIDTH, WINDOW_HEIGHT,
-                    SDL_WINDOW_SHOWN);
-
-    SDL_Renderer* screen_renderer = SDL_CreateRenderer(window, -1, 0);
-
-    SDL_Texture* screen = SDL_CreateTexture(screen_renderer,
-                          SDL_PIXELFORMAT_ARGB8888,
-                          SDL_TEXTUREACCESS_STREAMING,
-                          WINDOW_WIDTH, WINDOW_HEIGHT);
-    
-    Frame frame(WINDOW_WIDTH, WINDOW_HEIGHT, SDL_AllocFormat(SDL_PIXELFORMAT_ARGB8888));
-
-    auto texture = std::make_shared<Texture>("img/african_head_diffuse.tga"); 
-    auto mesh = std::make_shared<Mesh>("obj/african_head.obj", texture);    
-    auto model = std::make_unique<mat4>(makeTranslation(0,0,0));
-
-    Object head(std::move(mesh), std::move(model));
-
-    World world;
-    world.addObject(&head);
-
-    PhongShader shader(world, frame);
-    
-    Renderer framebuffer_renderer(world, frame, shader);
-
-    double eye_angle = M_PI/2;
-    double light_angle = M_PI/2;
-    double ROT_SPEED = 0.1f;
-    double DISTANCE = 2;
-    double TWO_PI = 2.0*M_PI;
-    
-    while (!quit)
-    {
-        while (SDL_PollEvent(&event) != 0)
-        {
-            switch (event.type)
-            {
-            case SDL_KEYDOWN:
-                switch( event.key.keysym.sym )
-                {
-                case SDLK_LEFT:
-                    eye_angle = std::fmod(eye_angle + ROT_SPEED, TWO_PI);
-                    break;
-                case SDLK_RIGHT:
-                    eye_angle = std::fmod(eye_angle - ROT_SPEED, TWO_PI);
-                    break;
-                case SDLK_a:
-                    light_angle = std::fmod(light_angle + ROT_SPEED, TWO_PI);
-                    break;
-                case SDLK_d:
-                    light_angle = std::fmod(light_angle - ROT_SPEED, TWO_PI);
-                    break;
-                default:
-                    break;
-                }
-            case SDL_KEYUP:
-                break;
-            case SDL_QUIT:
-                quit = 1;
-                break;
-            default:
-                break;
-            }
-        }
-
-        world.set_eye(vec3(cos(eye_angle) * DISTANCE, 1, sin(eye_angle) * DISTANCE));
-        world.set_light(vec3(cos(light_angle) * DISTANCE, 1, sin(light_angle) * DISTANCE));
-
-        framebuffer_renderer.render();
-        frame.flip_image_on_x_axis();
-
-        SDL_UpdateTexture(screen, NULL, frame.buffer, WINDOW_WIDTH * sizeof(uint32_t));
-        
-        SDL_RenderClear(screen_renderer);
-        SDL_RenderCopy(screen_renderer, screen, NULL, NULL);
-        SDL_RenderPresent(screen_renderer);
-    }
-
-    SDL_DestroyWindow(window);
-    SDL_Quit();
-    return 0;
-}
+#include <iostream>
+#include <chrono>
+#include <memory>
+#include <limits>
+#include <utility>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "vec2.h"
+#include "vec3.h"
+#include "vec4.h"
+#include "mat4.h"
+#include "frame.h"
+#include "object.h"
+#include "texture.h"
+#include "utils.h"
+#include "mesh.h"
+#include "world.h"
+#include "renderer.h"
+#include "benchmarks.h"
+#include "shaders/gouraud_shader.h"
+#include "shaders/phong_shader.h"
+
+#define trace(var)  { std::cout << "Line " << __LINE__ << ": " << #var << "=" << var << "\n";}
+#include "SDL.h"
+
+const inline int WINDOW_WIDTH = 800;
+const inline int WINDOW_HEIGHT = 800;
+
+bool quit = false;
+
+#undef main // windows fix: unresolved external symbol https://stackoverflow.com/questions/4845410/error-lnk2019-unresolved-external-symbol-main-referenced-in-function-tmainc
+int main(int argc, char * argv[]) {
+    // "3DSR optimize a.obj b.obj ..." rebuilds the optimized mesh caches of the given files and quits.
+    if (argc >= 2 && std::string(argv[1]) == "optimize")
+    {
+        for (int i = 2; i < argc; i++)
+        {
+            std::remove(mesh_cache_path(argv[i]).c_str());
+            Mesh mesh(argv[i]);
+        }
+        return 0;
+    }
+
+    // "3DSR bench parse [a.obj...]" times the OBJ parsers, "3DSR bench cull [max objects]" the visibility queries.
+    if (argc >= 3 && std::string(argv[1]) == "bench")
+    {
+        std::string name = argv[2];
+        std::vector<std::string> arguments(argv + 3, argv + argc);
+        if (name == "parse") return run_parse_benchmark(arguments);
+        if (name == "cull") return run_cull_benchmark(arguments.empty() ? 1000000 : std::stoi(arguments[0]));
+        std::cerr << "Unknown benchmark " << name << std::endl;
+        return 1;
+    }
+
+    SDL_Event event;
+
+    if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+        SDL_Log("Unable to initialize SDL: %s", SDL_GetError());
+        return 1;
+    }
+
+    SDL_Window* window = SDL_CreateWindow("3DSR",
+                    SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+                    WINDOW_WIDTH, WINDOW_HEIGHT,
+                    SDL_WINDOW_SHOWN);
+
+    SDL_Renderer* screen_renderer = SDL_CreateRenderer(window, -1, 0);
+
+    SDL_Texture* screen = SDL_CreateTexture(screen_renderer,
+                          SDL_PIXELFORMAT_ARGB8888,
+                          SDL_TEXTUREACCESS_STREAMING,
+                          WINDOW_WIDTH, WINDOW_HEIGHT);
+    
+    Frame frame(WINDOW_WIDTH, WINDOW_HEIGHT, SDL_AllocFormat(SDL_PIXELFORMAT_ARGB8888));
+
+    auto texture = std::make_shared<Texture>("img/african_head_diffuse.tga"); 
+    auto load_start = std::chrono::steady_clock::now();
+    auto mesh = std::make_shared<Mesh>("obj/african_head.obj", texture);    
+    std::chrono::duration<double, std::milli> load_time = std::chrono::steady_clock::now() - load_start;
+    std::cout << "african_head: " << mesh->getVertexCount() << " vertices, " << mesh->getTriangleCount()
+              << " triangles, ACMR " << mesh->acmr() << ", loaded in " << load_time.count() << " ms" << std::endl;
+    auto model = std::make_unique<mat4>(makeTranslation(0,0,0));
+
+    Object head(std::move(mesh), std::move(model));
+
+    World world;
+    world.addObject(&head);
+
+    PhongShader shader(world, frame);
+    
+    Renderer framebuffer_renderer(world, frame, shader);
+
+    double eye_angle = M_PI/2;
+    double light_angle = M_PI/2;
+    double ROT_SPEED = 0.1f;
+    double DISTANCE = 2;
+    double TWO_PI = 2.0*M_PI;
+    
+    while (!quit)
+    {
+        while (SDL_PollEvent(&event) != 0)
+        {
+            switch (event.type)
+            {
+            case SDL_KEYDOWN:
+                switch( event.key.keysym.sym )
+                {
+                case SDLK_LEFT:
+                    eye_angle = std::fmod(eye_angle + ROT_SPEED, TWO_PI);
+                    break;
+                case SDLK_RIGHT:
+                    eye_angle = std::fmod(eye_angle - ROT_SPEED, TWO_PI);
+                    break;
+                case SDLK_a:
+                    light_angle = std::fmod(light_angle + ROT_SPEED, TWO_PI);
+                    break;
+                case SDLK_d:
+                    light_angle = std::fmod(light_angle - ROT_SPEED, TWO_PI);
+                    break;
+                case SDLK_s:
+                    framebuffer_renderer.get_stats().print();
+                    break;
+                case SDLK_m:
+                    framebuffer_renderer.set_shading_mode(framebuffer_renderer.get_shading_mode() == ShadingMode::Forward ? ShadingMode::Deferred : ShadingMode::Forward);
+                    break;
+                case SDLK_p:
+                    // Cycles through 1, 2 and 3 frames in flight.
+                    framebuffer_renderer.set_pipeline_depth(framebuffer_renderer.get_pipeline_depth() % Renderer::MAX_PIPELINE_DEPTH + 1);
+                    std::cout << "frames in flight: " << framebuffer_renderer.get_pipeline_depth() << std::endl;
+                    break;
+                default:
+                    break;
+                }
+            case SDL_KEYUP:
+                break;
+            case SDL_QUIT:
+                quit = 1;
+                break;
+            default:
+                break;
+            }
+        }
+
+        world.set_eye(vec3(cos(eye_angle) * DISTANCE, 1, sin(eye_angle) * DISTANCE));
+        world.set_light(vec3(cos(light_angle) * DISTANCE, 1, sin(light_angle) * DISTANCE));
+
+        // While the pipeline fills up after a change of depth, the last frame shown stays on the screen.
+        Frame* rendered = framebuffer_renderer.render();
+        if (rendered != nullptr)
+        {
+            rendered->flip_image_on_x_axis();
+            SDL_UpdateTexture(screen, NULL, rendered->buffer, WINDOW_WIDTH * sizeof(uint32_t));
+        }
+        
+        SDL_RenderClear(screen_renderer);
+        SDL_RenderCopy(screen_renderer, screen, NULL, NULL);
+        SDL_RenderPresent(screen_renderer);
+    }
+
+    SDL_DestroyWindow(window);
+    SDL_Quit();
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+std::unique_ptr<MappedFile> MappedFile::open(const std::string& path)
+{
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return nullptr;
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (view == nullptr)
+    {
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        return nullptr;
+    }
+
+    std::unique_ptr<MappedFile> mapped(new MappedFile());
+    mapped->bytes = static_cast<const uint8_t*>(view);
+    mapped->length = (size_t) file_size.QuadPart;
+    mapped->file = file;
+    mapped->mapping = mapping;
+    return mapped;
+}
+
+MappedFile::~MappedFile()
+{
+    UnmapViewOfFile(bytes);
+    CloseHandle(mapping);
+    CloseHandle(file);
+}
+#else
+std::unique_ptr<MappedFile> MappedFile::open(const std::string& path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        close(fd);
+        return nullptr;
+    }
+
+    // The mapping keeps its own reference to the file, so the descriptor isn't needed afterwards.
+    void* view = mmap(nullptr, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED) return nullptr;
+
+    std::unique_ptr<MappedFile> mapped(new MappedFile());
+    mapped->bytes = static_cast<const uint8_t*>(view);
+    mapped->length = (size_t) info.st_size;
+    return mapped;
+}
+
+MappedFile::~MappedFile()
+{
+    munmap(const_cast<uint8_t*>(bytes), length);
+}
+#endif
+
+const uint8_t* MappedFile::data() const
+{
+    return bytes;
+}
+
+size_t MappedFile::size() const
+{
+    return length;
+}
@@ -0,0 +1,31 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// A whole file mapped read-only into memory. The operating system pages it in on first touch,
+// so nothing is read or copied up front. The mapping lives as long as the object.
+class MappedFile
+{
+    public:
+        // Returns nullptr if the file doesn't exist, is empty or can't be mapped.
+        static std::unique_ptr<MappedFile> open(const std::string& path);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        const uint8_t* data() const;
+        size_t size() const;
+
+    private:
+        MappedFile() = default;
+
+        const uint8_t* bytes = nullptr;
+        size_t length = 0;
+#ifdef _WIN32
+        void* file = nullptr;
+        void* mapping = nullptr;
+#endif
+};
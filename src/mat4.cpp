@@ -1,203 +1,341 @@
-#include "mat4.h"
-
-mat4::mat4()
-{
-            n[0][0] = 1; n[0][1] = 0; n[0][2] = 0; n[0][3] = 0;
-            n[1][0] = 0; n[1][1] = 1; n[1][2] = 0; n[1][3] = 0;
-            n[2][0] = 0; n[2][1] = 0; n[2][2] = 1; n[2][3] = 0;
-            n[3][0] = 0; n[3][1] = 0; n[3][2] = 0; n[3][3] = 1;
-}
-
-
-mat4::mat4(float n00, float n01, float n02, float n03,
-           float n10, float n11, float n12, float n13,
-           float n20, float n21, float n22, float n23,
-           float n30, float n31, float n32, float n33)
-{
-    n[0][0] = n00; n[1][0] = n01; n[2][0] = n02; n[3][0] = n03;
-    n[0][1] = n10; n[1][1] = n11; n[2][1] = n12; n[3][1] = n13;
-    n[0][2] = n20; n[1][2] = n21; n[2][2] = n22; n[3][2] = n23;
-    n[0][3] = n30; n[1][3] = n31; n[2][3] = n32; n[3][3] = n33;
-}
-
-mat4::mat4(const vec4& a, const vec4& b, const vec4& c, const vec4& d)
-{    
-    n[0][0] = a.x; n[1][0] = b.x; n[2][0] = c.x; n[3][0] = d.x;
-    n[0][1] = a.y; n[1][1] = b.y; n[2][1] = c.y; n[3][1] = d.y;
-    n[0][2] = a.z; n[1][2] = b.z; n[2][2] = c.z; n[3][2] = d.z;
-    n[0][3] = a.w; n[1][3] = b.w; n[2][3] = c.w; n[3][3] = d.w;
-}
-
-float& mat4::operator()(int i, int j)
-{
-    return (n[j][i]);
-}
-
-const float& mat4::operator()(int i, int j) const
-{
-    return (n[j][i]);
-}
-
-vec4& mat4::operator[](int j)
-{
-    return (*reinterpret_cast<vec4*>(n[j]));
-}
-
-const vec4& mat4::operator[](int j) const
-{
-    return (*reinterpret_cast<const vec4*>(n[j]));
-}
-
-void mat4::print()
-{
-    std::cout << "Mat4: " << std::endl;
-    std::cout << n[0][0] << n[1][0] << n[2][0] << n[3][0] << std::endl;  
-    std::cout << n[0][1] << n[1][1] << n[2][1] << n[3][1] << std::endl;  
-    std::cout << n[0][2] << n[1][2] << n[2][2] << n[3][2] << std::endl;  
-    std::cout << n[0][3] << n[1][3] << n[2][3] << n[3][3] << std::endl;  
-}
-
-// https://stackoverflow.com/questions/1148309/inverting-a-4x4-matrix
-mat4 inverse(const mat4& M)
-{
-    float A2323 = M(2,2) * M(3,3) - M(2,3) * M(3,2);
-    float A1323 = M(2,1) * M(3,3) - M(2,3) * M(3,1);
-    float A1223 = M(2,1) * M(3,2) - M(2,2) * M(3,1);
-    float A0323 = M(2,0) * M(3,3) - M(2,3) * M(3,0);
-    float A0223 = M(2,0) * M(3,2) - M(2,2) * M(3,0);
-    float A0123 = M(2,0) * M(3,1) - M(2,1) * M(3,0);
-    float A2313 = M(1,2) * M(3,3) - M(1,3) * M(3,2);
-    float A1313 = M(1,1) * M(3,3) - M(1,3) * M(3,1);
-    float A1213 = M(1,1) * M(3,2) - M(1,2) * M(3,1);
-    float A2312 = M(1,2) * M(2,3) - M(1,3) * M(2,2);
-    float A1312 = M(1,1) * M(2,3) - M(1,3) * M(2,1);
-    float A1212 = M(1,1) * M(2,2) - M(1,2) * M(2,1);
-    float A0313 = M(1,0) * M(3,3) - M(1,3) * M(3,0);
-    float A0213 = M(1,0) * M(3,2) - M(1,2) * M(3,0);
-    float A0312 = M(1,0) * M(2,3) - M(1,3) * M(2,0);
-    float A0212 = M(1,0) * M(2,2) - M(1,2) * M(2,0);
-    float A0113 = M(1,0) * M(3,1) - M(1,1) * M(3,0);
-    float A0112 = M(1,0) * M(2,1) - M(1,1) * M(2,0);
-
-    float det = M(0,0) * ( M(1,1) * A2323 - M(1,2) * A1323 + M(1,3) * A1223 ) 
-              - M(0,1) * ( M(1,0) * A2323 - M(1,2) * A0323 + M(1,3) * A0223 ) 
-              + M(0,2) * ( M(1,0) * A1323 - M(1,1) * A0323 + M(1,3) * A0123 ) 
-              - M(0,3) * ( M(1,0) * A1223 - M(1,1) * A0223 + M(1,2) * A0123 );
-    det = 1 / det;
-
-    mat4 i;    
-    i(0,0) = det *   ( M(1,1) * A2323 - M(1,2) * A1323 + M(1,3) * A1223 );
-    i(0,1) = det * - ( M(0,1) * A2323 - M(0,2) * A1323 + M(0,3) * A1223 );
-    i(0,2) = det *   ( M(0,1) * A2313 - M(0,2) * A1313 + M(0,3) * A1213 );
-    i(0,3) = det * - ( M(0,1) * A2312 - M(0,2) * A1312 + M(0,3) * A1212 );
-    i(1,0) = det * - ( M(1,0) * A2323 - M(1,2) * A0323 + M(1,3) * A0223 );
-    i(1,1) = det *   ( M(0,0) * A2323 - M(0,2) * A0323 + M(0,3) * A0223 );
-    i(1,2) = det * - ( M(0,0) * A2313 - M(0,2) * A0313 + M(0,3) * A0213 );
-    i(1,3) = det *   ( M(0,0) * A2312 - M(0,2) * A0312 + M(0,3) * A0212 );
-    i(2,0) = det *   ( M(1,0) * A1323 - M(1,1) * A0323 + M(1,3) * A0123 );
-    i(2,1) = det * - ( M(0,0) * A1323 - M(0,1) * A0323 + M(0,3) * A0123 );
-    i(2,2) = det *   ( M(0,0) * A1313 - M(0,1) * A0313 + M(0,3) * A0113 );
-    i(2,3) = det * - ( M(0,0) * A1312 - M(0,1) * A0312 + M(0,3) * A0112 );
-    i(3,0) = det * - ( M(1,0) * A1223 - M(1,1) * A0223 + M(1,2) * A0123 );
-    i(3,1) = det *   ( M(0,0) * A1223 - M(0,1) * A0223 + M(0,2) * A0123 );
-    i(3,2) = det * - ( M(0,0) * A1213 - M(0,1) * A0213 + M(0,2) * A0113 );
-    i(3,3) = det *   ( M(0,0) * A1212 - M(0,1) * A0212 + M(0,2) * A0112 );
-
-    return i;
-}
-
-mat4 transpose(const mat4& M)
-{
-    return mat4(M(0, 0), M(1, 0), M(2, 0), M(3, 0),
-                M(0, 1), M(1, 1), M(2, 1), M(3, 1),
-                M(0, 2), M(1, 2), M(2, 2), M(3, 2),
-                M(0, 3), M(1, 3), M(2, 3), M(3, 3));
-}
-
-mat4 identity()
-{
-    return mat4(1, 0, 0, 0,
-                0, 1, 0, 0,
-                0, 0, 1, 0,
-                0, 0, 0, 1);
-}
-
-mat4 makeXRotation(double deg)
-{
-    double rad = deg * PI / 180.0;
-    return mat4(1, 0,        0,         0,
-                0, cos(rad), -sin(rad), 0,
-                0, sin(rad), cos(rad),  0,
-                0, 0,        0,         1);
-}
-mat4 makeYRotation(double deg)
-{
-    double rad = deg * PI / 180.0;
-    return mat4(cos(rad),  0, sin(rad), 0,
-                0,         1, 0,        0,
-                -sin(rad), 0, cos(rad), 0,
-                0,         0, 0,        1);
-}
-mat4 makeZRotation(double deg)
-{
-    double rad = deg * PI / 180.0;
-    return mat4(cos(rad),  -sin(rad), 0, 0,
-                sin(rad),  cos(rad),  0, 0,
-                0,         0,         1, 0,
-                0,         0,         0, 1);
-}
-
-mat4 makeScale(double sx, double sy, double sz)
-{
-    return mat4(sx, 0,  0,  0,
-                0,  sy, 0,  0,
-                0,  0,  sz, 0,
-                0,  0,  0,  1);
-}
-mat4 makeTranslation(double tx, double ty, double tz)
-{
-    return mat4(1, 0, 0, tx,
-                0, 1, 0, ty,
-                0, 0, 1, tz,
-                0, 0, 0, 1);
-}
-
-mat4 transFactor(const mat4& M)
-{
-    return mat4(1, 0, 0, M(0,3),
-                0, 1, 0, M(1,3),
-                0, 0, 1, M(2,3),
-                0, 0, 0, 1);
-}
-
-mat4 linFact(const mat4& M)
-{
-    return mat4(M(0,0), M(0,1), M(0,2), 0,
-                M(1,0), M(1,1), M(1,2), 0,
-                M(2,0), M(2,1), M(2,2), 0,
-                0,      0,      0,      1);
-}
-
-mat4 normalMatrix(const mat4& M)
-{
-    return inverse(transpose(linFact(M)));
-}
-
-vec4 operator*(const mat4& M, const vec4& v)
-{
-    return (vec4((M(0,0) * v.x) + (M(0,1) * v.y) + (M(0,2) * v.z) + (M(0,3) * v.w),
-                 (M(1,0) * v.x) + (M(1,1) * v.y) + (M(1,2) * v.z) + (M(1,3) * v.w),
-                 (M(2,0) * v.x) + (M(2,1) * v.y) + (M(2,2) * v.z) + (M(2,3) * v.w),
-                 (M(3,0) * v.x) + (M(3,1) * v.y) + (M(3,2) * v.z) + (M(3,3) * v.w)));
-}
-
-mat4 operator*(const mat4& M0, const mat4& M1)
-{
-    std::vector<vec4> new_columns;
-    for (int i = 0; i < 4; i++)
-    {
-        vec4 column = M1[i];
-        new_columns.push_back(M0 * column);
-    }
-    return mat4(new_columns[0], new_columns[1], new_columns[2], new_columns[3]);
-}
+#include "mat4.h"
+
+mat4::mat4()
+{
+            n[0][0] = 1; n[0][1] = 0; n[0][2] = 0; n[0][3] = 0;
+            n[1][0] = 0; n[1][1] = 1; n[1][2] = 0; n[1][3] = 0;
+            n[2][0] = 0; n[2][1] = 0; n[2][2] = 1; n[2][3] = 0;
+            n[3][0] = 0; n[3][1] = 0; n[3][2] = 0; n[3][3] = 1;
+}
+
+
+mat4::mat4(float n00, float n01, float n02, float n03,
+           float n10, float n11, float n12, float n13,
+           float n20, float n21, float n22, float n23,
+           float n30, float n31, float n32, float n33)
+{
+    n[0][0] = n00; n[1][0] = n01; n[2][0] = n02; n[3][0] = n03;
+    n[0][1] = n10; n[1][1] = n11; n[2][1] = n12; n[3][1] = n13;
+    n[0][2] = n20; n[1][2] = n21; n[2][2] = n22; n[3][2] = n23;
+    n[0][3] = n30; n[1][3] = n31; n[2][3] = n32; n[3][3] = n33;
+}
+
+mat4::mat4(const vec4& a, const vec4& b, const vec4& c, const vec4& d)
+{    
+    n[0][0] = a.x; n[1][0] = b.x; n[2][0] = c.x; n[3][0] = d.x;
+    n[0][1] = a.y; n[1][1] = b.y; n[2][1] = c.y; n[3][1] = d.y;
+    n[0][2] = a.z; n[1][2] = b.z; n[2][2] = c.z; n[3][2] = d.z;
+    n[0][3] = a.w; n[1][3] = b.w; n[2][3] = c.w; n[3][3] = d.w;
+}
+
+void mat4::print()
+{
+    std::cout << "Mat4: " << std::endl;
+    std::cout << n[0][0] << n[1][0] << n[2][0] << n[3][0] << std::endl;  
+    std::cout << n[0][1] << n[1][1] << n[2][1] << n[3][1] << std::endl;  
+    std::cout << n[0][2] << n[1][2] << n[2][2] << n[3][2] << std::endl;  
+    std::cout << n[0][3] << n[1][3] << n[2][3] << n[3][3] << std::endl;  
+}
+
+#ifdef MATH_SIMD
+// Picks lanes x, y from a and z, w from b.
+#define MAT4_SHUFFLE(a, b, x, y, z, w) _mm_shuffle_ps((a), (b), _MM_SHUFFLE((w), (z), (y), (x)))
+#define MAT4_SWIZZLE(v, x, y, z, w) MAT4_SHUFFLE((v), (v), (x), (y), (z), (w))
+
+// The inverse below works on 2x2 blocks of the matrix, each held in one register as (m00, m01, m10, m11).
+
+// A * B
+static inline __m128 mat2_mul(__m128 a, __m128 b)
+{
+    return _mm_add_ps(_mm_mul_ps(a, MAT4_SWIZZLE(b, 0, 3, 0, 3)),
+                      _mm_mul_ps(MAT4_SWIZZLE(a, 1, 0, 3, 2), MAT4_SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+// adj(A) * B
+static inline __m128 mat2_adj_mul(__m128 a, __m128 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(MAT4_SWIZZLE(a, 3, 3, 0, 0), b),
+                      _mm_mul_ps(MAT4_SWIZZLE(a, 1, 1, 2, 2), MAT4_SWIZZLE(b, 2, 3, 0, 1)));
+}
+
+// A * adj(B)
+static inline __m128 mat2_mul_adj(__m128 a, __m128 b)
+{
+    return _mm_sub_ps(_mm_mul_ps(a, MAT4_SWIZZLE(b, 3, 0, 3, 0)),
+                      _mm_mul_ps(MAT4_SWIZZLE(a, 1, 0, 3, 2), MAT4_SWIZZLE(b, 2, 1, 2, 1)));
+}
+
+// Blockwise inversion, see https://lxjk.github.io/2017/09/03/Fast-4x4-Matrix-Inverse-with-SSE-SIMD-Explained.html
+// The derivation is written for rows, but inv(transpose(M)) = transpose(inv(M)), so it works on our columns unchanged.
+mat4 inverse(const mat4& M)
+{
+    __m128 c0 = M[0].simd();
+    __m128 c1 = M[1].simd();
+    __m128 c2 = M[2].simd();
+    __m128 c3 = M[3].simd();
+
+    // M = | A B |
+    //     | C D |
+    __m128 A = _mm_movelh_ps(c0, c1);
+    __m128 B = _mm_movehl_ps(c1, c0);
+    __m128 C = _mm_movelh_ps(c2, c3);
+    __m128 D = _mm_movehl_ps(c3, c2);
+
+    // (det(A), det(B), det(C), det(D))
+    __m128 det_sub = _mm_sub_ps(_mm_mul_ps(MAT4_SHUFFLE(c0, c2, 0, 2, 0, 2), MAT4_SHUFFLE(c1, c3, 1, 3, 1, 3)),
+                                _mm_mul_ps(MAT4_SHUFFLE(c0, c2, 1, 3, 1, 3), MAT4_SHUFFLE(c1, c3, 0, 2, 0, 2)));
+    __m128 det_A = MAT4_SWIZZLE(det_sub, 0, 0, 0, 0);
+    __m128 det_B = MAT4_SWIZZLE(det_sub, 1, 1, 1, 1);
+    __m128 det_C = MAT4_SWIZZLE(det_sub, 2, 2, 2, 2);
+    __m128 det_D = MAT4_SWIZZLE(det_sub, 3, 3, 3, 3);
+
+    __m128 D_C = mat2_adj_mul(D, C);
+    __m128 A_B = mat2_adj_mul(A, B);
+
+    // The blocks of adj(M): X = det(D) A - B adj(D) C, W = det(A) D - C adj(A) B, and so on.
+    __m128 X = _mm_sub_ps(_mm_mul_ps(det_D, A), mat2_mul(B, D_C));
+    __m128 W = _mm_sub_ps(_mm_mul_ps(det_A, D), mat2_mul(C, A_B));
+    __m128 Y = _mm_sub_ps(_mm_mul_ps(det_B, C), mat2_mul_adj(D, A_B));
+    __m128 Z = _mm_sub_ps(_mm_mul_ps(det_C, B), mat2_mul_adj(A, D_C));
+
+    // det(M) = det(A) det(D) + det(B) det(C) - tr(adj(A) B adj(D) C)
+    __m128 trace = _mm_mul_ps(A_B, MAT4_SWIZZLE(D_C, 0, 2, 1, 3));
+    trace = _mm_add_ps(trace, _mm_movehl_ps(trace, trace));
+    trace = _mm_add_ps(trace, MAT4_SWIZZLE(trace, 1, 1, 1, 1));
+    trace = MAT4_SWIZZLE(trace, 0, 0, 0, 0);
+
+    __m128 det = _mm_add_ps(_mm_mul_ps(det_A, det_D), _mm_mul_ps(det_B, det_C));
+    det = _mm_sub_ps(det, trace);
+
+    // The adjugate of each 2x2 block flips the signs of its off-diagonal entries.
+    __m128 det_reciprocal = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), det);
+    X = _mm_mul_ps(X, det_reciprocal);
+    Y = _mm_mul_ps(Y, det_reciprocal);
+    Z = _mm_mul_ps(Z, det_reciprocal);
+    W = _mm_mul_ps(W, det_reciprocal);
+
+    mat4 i;
+    i[0] = vec4(MAT4_SHUFFLE(X, Y, 3, 1, 3, 1));
+    i[1] = vec4(MAT4_SHUFFLE(X, Y, 2, 0, 2, 0));
+    i[2] = vec4(MAT4_SHUFFLE(Z, W, 3, 1, 3, 1));
+    i[3] = vec4(MAT4_SHUFFLE(Z, W, 2, 0, 2, 0));
+    return i;
+}
+
+#undef MAT4_SWIZZLE
+#undef MAT4_SHUFFLE
+#endif
+
+// https://stackoverflow.com/questions/1148309/inverting-a-4x4-matrix
+#ifndef MATH_SIMD
+mat4 inverse(const mat4& M)
+{
+    float A2323 = M(2,2) * M(3,3) - M(2,3) * M(3,2);
+    float A1323 = M(2,1) * M(3,3) - M(2,3) * M(3,1);
+    float A1223 = M(2,1) * M(3,2) - M(2,2) * M(3,1);
+    float A0323 = M(2,0) * M(3,3) - M(2,3) * M(3,0);
+    float A0223 = M(2,0) * M(3,2) - M(2,2) * M(3,0);
+    float A0123 = M(2,0) * M(3,1) - M(2,1) * M(3,0);
+    float A2313 = M(1,2) * M(3,3) - M(1,3) * M(3,2);
+    float A1313 = M(1,1) * M(3,3) - M(1,3) * M(3,1);
+    float A1213 = M(1,1) * M(3,2) - M(1,2) * M(3,1);
+    float A2312 = M(1,2) * M(2,3) - M(1,3) * M(2,2);
+    float A1312 = M(1,1) * M(2,3) - M(1,3) * M(2,1);
+    float A1212 = M(1,1) * M(2,2) - M(1,2) * M(2,1);
+    float A0313 = M(1,0) * M(3,3) - M(1,3) * M(3,0);
+    float A0213 = M(1,0) * M(3,2) - M(1,2) * M(3,0);
+    float A0312 = M(1,0) * M(2,3) - M(1,3) * M(2,0);
+    float A0212 = M(1,0) * M(2,2) - M(1,2) * M(2,0);
+    float A0113 = M(1,0) * M(3,1) - M(1,1) * M(3,0);
+    float A0112 = M(1,0) * M(2,1) - M(1,1) * M(2,0);
+
+    float det = M(0,0) * ( M(1,1) * A2323 - M(1,2) * A1323 + M(1,3) * A1223 ) 
+              - M(0,1) * ( M(1,0) * A2323 - M(1,2) * A0323 + M(1,3) * A0223 ) 
+              + M(0,2) * ( M(1,0) * A1323 - M(1,1) * A0323 + M(1,3) * A0123 ) 
+              - M(0,3) * ( M(1,0) * A1223 - M(1,1) * A0223 + M(1,2) * A0123 );
+    det = 1 / det;
+
+    mat4 i;    
+    i(0,0) = det *   ( M(1,1) * A2323 - M(1,2) * A1323 + M(1,3) * A1223 );
+    i(0,1) = det * - ( M(0,1) * A2323 - M(0,2) * A1323 + M(0,3) * A1223 );
+    i(0,2) = det *   ( M(0,1) * A2313 - M(0,2) * A1313 + M(0,3) * A1213 );
+    i(0,3) = det * - ( M(0,1) * A2312 - M(0,2) * A1312 + M(0,3) * A1212 );
+    i(1,0) = det * - ( M(1,0) * A2323 - M(1,2) * A0323 + M(1,3) * A0223 );
+    i(1,1) = det *   ( M(0,0) * A2323 - M(0,2) * A0323 + M(0,3) * A0223 );
+    i(1,2) = det * - ( M(0,0) * A2313 - M(0,2) * A0313 + M(0,3) * A0213 );
+    i(1,3) = det *   ( M(0,0) * A2312 - M(0,2) * A0312 + M(0,3) * A0212 );
+    i(2,0) = det *   ( M(1,0) * A1323 - M(1,1) * A0323 + M(1,3) * A0123 );
+    i(2,1) = det * - ( M(0,0) * A1323 - M(0,1) * A0323 + M(0,3) * A0123 );
+    i(2,2) = det *   ( M(0,0) * A1313 - M(0,1) * A0313 + M(0,3) * A0113 );
+    i(2,3) = det * - ( M(0,0) * A1312 - M(0,1) * A0312 + M(0,3) * A0112 );
+    i(3,0) = det * - ( M(1,0) * A1223 - M(1,1) * A0223 + M(1,2) * A0123 );
+    i(3,1) = det *   ( M(0,0) * A1223 - M(0,1) * A0223 + M(0,2) * A0123 );
+    i(3,2) = det * - ( M(0,0) * A1213 - M(0,1) * A0213 + M(0,2) * A0113 );
+    i(3,3) = det *   ( M(0,0) * A1212 - M(0,1) * A0212 + M(0,2) * A0112 );
+
+    return i;
+}
+#endif
+
+mat4 transpose(const mat4& M)
+{
+#ifdef MATH_SIMD
+    __m128 c0 = M[0].simd();
+    __m128 c1 = M[1].simd();
+    __m128 c2 = M[2].simd();
+    __m128 c3 = M[3].simd();
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+    mat4 T;
+    T[0] = vec4(c0);
+    T[1] = vec4(c1);
+    T[2] = vec4(c2);
+    T[3] = vec4(c3);
+    return T;
+#else
+    return mat4(M(0, 0), M(1, 0), M(2, 0), M(3, 0),
+                M(0, 1), M(1, 1), M(2, 1), M(3, 1),
+                M(0, 2), M(1, 2), M(2, 2), M(3, 2),
+                M(0, 3), M(1, 3), M(2, 3), M(3, 3));
+#endif
+}
+
+mat4 identity()
+{
+    return mat4(1, 0, 0, 0,
+                0, 1, 0, 0,
+                0, 0, 1, 0,
+                0, 0, 0, 1);
+}
+
+mat4 makeXRotation(double deg)
+{
+    double rad = deg * PI / 180.0;
+    return mat4(1, 0,        0,         0,
+                0, cos(rad), -sin(rad), 0,
+                0, sin(rad), cos(rad),  0,
+                0, 0,        0,         1);
+}
+mat4 makeYRotation(double deg)
+{
+    double rad = deg * PI / 180.0;
+    return mat4(cos(rad),  0, sin(rad), 0,
+                0,         1, 0,        0,
+                -sin(rad), 0, cos(rad), 0,
+                0,         0, 0,        1);
+}
+mat4 makeZRotation(double deg)
+{
+    double rad = deg * PI / 180.0;
+    return mat4(cos(rad),  -sin(rad), 0, 0,
+                sin(rad),  cos(rad),  0, 0,
+                0,         0,         1, 0,
+                0,         0,         0, 1);
+}
+
+mat4 makeScale(double sx, double sy, double sz)
+{
+    return mat4(sx, 0,  0,  0,
+                0,  sy, 0,  0,
+                0,  0,  sz, 0,
+                0,  0,  0,  1);
+}
+mat4 makeTranslation(double tx, double ty, double tz)
+{
+    return mat4(1, 0, 0, tx,
+                0, 1, 0, ty,
+                0, 0, 1, tz,
+                0, 0, 0, 1);
+}
+
+mat4 transFactor(const mat4& M)
+{
+    return mat4(1, 0, 0, M(0,3),
+                0, 1, 0, M(1,3),
+                0, 0, 1, M(2,3),
+                0, 0, 0, 1);
+}
+
+mat4 linFact(const mat4& M)
+{
+    return mat4(M(0,0), M(0,1), M(0,2), 0,
+                M(1,0), M(1,1), M(1,2), 0,
+                M(2,0), M(2,1), M(2,2), 0,
+                0,      0,      0,      1);
+}
+
+mat4 normalMatrix(const mat4& M)
+{
+    return inverse(transpose(linFact(M)));
+}
+
+mat4 operator*(const mat4& M0, const mat4& M1)
+{
+    // Each column of the product is M0 applied to the matching column of M1.
+    mat4 product;
+    for (int i = 0; i < 4; i++)
+    {
+        product[i] = M0 * M1[i];
+    }
+    return product;
+}
+
+void transform(const mat4& M, const vec4* in, vec4* out, size_t count)
+{
+#ifdef MATH_SIMD
+    // Keep the columns in registers across the whole array.
+    __m128 c0 = M[0].simd();
+    __m128 c1 = M[1].simd();
+    __m128 c2 = M[2].simd();
+    __m128 c3 = M[3].simd();
+
+    for (size_t i = 0; i < count; i++)
+    {
+        __m128 v = in[i].simd();
+        __m128 result = _mm_mul_ps(c0, _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)));
+        result = _mm_add_ps(result, _mm_mul_ps(c1, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1))));
+        result = _mm_add_ps(result, _mm_mul_ps(c2, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2))));
+        result = _mm_add_ps(result, _mm_mul_ps(c3, _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3))));
+        out[i] = vec4(result);
+    }
+#else
+    for (size_t i = 0; i < count; i++)
+    {
+        out[i] = M * in[i];
+    }
+#endif
+}
+
+void transform_points(const mat4& M, const float* x, const float* y, const float* z, vec4* out, size_t count)
+{
+    size_t i = 0;
+#ifdef MATH_SIMD
+    // Four points at a time: each register holds one component of all four, computed the same way as M * v.
+    // A transpose then turns them back into four vec4s.
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 px = _mm_loadu_ps(x + i);
+        __m128 py = _mm_loadu_ps(y + i);
+        __m128 pz = _mm_loadu_ps(z + i);
+
+        __m128 rows[4];
+        for (int r = 0; r < 4; r++)
+        {
+            __m128 row = _mm_mul_ps(_mm_set1_ps(M(r, 0)), px);
+            row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(M(r, 1)), py));
+            row = _mm_add_ps(row, _mm_mul_ps(_mm_set1_ps(M(r, 2)), pz));
+            rows[r] = _mm_add_ps(row, _mm_set1_ps(M(r, 3)));
+        }
+        _MM_TRANSPOSE4_PS(rows[0], rows[1], rows[2], rows[3]);
+
+        out[i + 0] = vec4(rows[0]);
+        out[i + 1] = vec4(rows[1]);
+        out[i + 2] = vec4(rows[2]);
+        out[i + 3] = vec4(rows[3]);
+    }
+#endif
+    for (; i < count; i++)
+    {
+        out[i] = M * vec4(x[i], y[i], z[i], 1);
+    }
+}
@@ -1,46 +1,83 @@
-#pragma once
-#include <vector>
-#include <math.h>
-#include "vec4.h"
-
-#define PI 3.14159265
-
-// Implementation inspired by Eric Lengyel's in Foundations of Game Engine Development Vol 1.
-class mat4
-{
-    private:
-        float n[4][4];
-    public:
-        mat4();
-
-        // Column-major order, for easy retrieval of column vectors.
-        mat4(float n00, float n01, float n02, float n03,
-             float n10, float n11, float n12, float n13,
-             float n20, float n21, float n22, float n23,
-             float n30, float n31, float n32, float n33);
-        mat4(const vec4& a, const vec4& b, const vec4& c, const vec4& d);
-
-        float& operator()(int row, int col);
-        const float& operator()(int row, int col) const;
-
-        // Return the column vector at the index j.
-        vec4& operator[](int j);
-        const vec4& operator[](int j) const;
-        
-        void print();
-};
-
-mat4 inverse(const mat4& M);
-mat4 transpose(const mat4& M);
-mat4 identity();
-mat4 makeXRotation(double deg);
-mat4 makeYRotation(double deg);
-mat4 makeZRotation(double deg);
-mat4 makeScale(double sx, double sy, double sz);
-mat4 makeTranslation(double tx, double ty, double tz);
-mat4 transFactor(const mat4& M);
-mat4 linFact(const mat4& M);
-mat4 normalMatrix(const mat4& M);
-
-vec4 operator*(const mat4& M, const vec4& v);
-mat4 operator*(const mat4& M0, const mat4& M1);
+#pragma once
+#include <cstddef>
+#include <math.h>
+#include "vec4.h"
+
+#define PI 3.14159265
+
+// Implementation inspired by Eric Lengyel's in Foundations of Game Engine Development Vol 1.
+// Stored as 4 aligned column vectors, so each column loads straight into an SSE register.
+class mat4
+{
+    private:
+        alignas(16) float n[4][4];
+    public:
+        mat4();
+
+        // Column-major order, for easy retrieval of column vectors.
+        mat4(float n00, float n01, float n02, float n03,
+             float n10, float n11, float n12, float n13,
+             float n20, float n21, float n22, float n23,
+             float n30, float n31, float n32, float n33);
+        mat4(const vec4& a, const vec4& b, const vec4& c, const vec4& d);
+
+        float& operator()(int row, int col)
+        {
+            return (n[col][row]);
+        }
+
+        const float& operator()(int row, int col) const
+        {
+            return (n[col][row]);
+        }
+
+        // Return the column vector at the index j.
+        vec4& operator[](int j)
+        {
+            return (*reinterpret_cast<vec4*>(n[j]));
+        }
+
+        const vec4& operator[](int j) const
+        {
+            return (*reinterpret_cast<const vec4*>(n[j]));
+        }
+        
+        void print();
+};
+
+mat4 inverse(const mat4& M);
+mat4 transpose(const mat4& M);
+mat4 identity();
+mat4 makeXRotation(double deg);
+mat4 makeYRotation(double deg);
+mat4 makeZRotation(double deg);
+mat4 makeScale(double sx, double sy, double sz);
+mat4 makeTranslation(double tx, double ty, double tz);
+mat4 transFactor(const mat4& M);
+mat4 linFact(const mat4& M);
+mat4 normalMatrix(const mat4& M);
+
+mat4 operator*(const mat4& M0, const mat4& M1);
+
+// Applies M to count vectors, reading from in and writing to out. in and out may be the same array.
+void transform(const mat4& M, const vec4* in, vec4* out, size_t count);
+
+// Applies M to count points (x[i], y[i], z[i], 1), given as separate arrays, and writes them to out.
+void transform_points(const mat4& M, const float* x, const float* y, const float* z, vec4* out, size_t count);
+
+// Inline, since it runs for every vertex: the weighted sum of M's columns.
+inline vec4 operator*(const mat4& M, const vec4& v)
+{
+#ifdef MATH_SIMD
+    __m128 result = _mm_mul_ps(M[0].simd(), _mm_set1_ps(v.x));
+    result = _mm_add_ps(result, _mm_mul_ps(M[1].simd(), _mm_set1_ps(v.y)));
+    result = _mm_add_ps(result, _mm_mul_ps(M[2].simd(), _mm_set1_ps(v.z)));
+    result = _mm_add_ps(result, _mm_mul_ps(M[3].simd(), _mm_set1_ps(v.w)));
+    return vec4(result);
+#else
+    return (vec4((M(0,0) * v.x) + (M(0,1) * v.y) + (M(0,2) * v.z) + (M(0,3) * v.w),
+                 (M(1,0) * v.x) + (M(1,1) * v.y) + (M(1,2) * v.z) + (M(1,3) * v.w),
+                 (M(2,0) * v.x) + (M(2,1) * v.y) + (M(2,2) * v.z) + (M(2,3) * v.w),
+                 (M(3,0) * v.x) + (M(3,1) * v.y) + (M(3,2) * v.z) + (M(3,3) * v.w)));
+#endif
+}
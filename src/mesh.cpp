@@ -1,90 +1,663 @@
-#define TINYOBJLOADER_IMPLEMENTATION
-#include "vertex.h"
-#include "mesh.h"
-
-// All vertices are stored in counter-clockwise order by default.
-void Mesh::parse_obj(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes, const std::vector<tinyobj::material_t>& materials)
-{
-    int shapeAmt = shapes.size();
-    
-    for (size_t s = 0; s < shapeAmt; s++)
-    {
-        int faceAmt = shapes[s].mesh.num_face_vertices.size();
-        size_t startVertexIdxOfFace = 0; // Vertices are not stored per face, but rather all in an array
-
-        for (size_t f = 0; f < faceAmt; f++)
-        {
-            int vertexAmt = shapes[s].mesh.num_face_vertices[f];
-            Face face;
-            
-            for (int vertexNum = 0; vertexNum < vertexAmt; vertexNum++)
-            {
-                Vertex vertex;
-
-                tinyobj::index_t idx = shapes[s].mesh.indices[startVertexIdxOfFace + vertexNum]; 
-
-                tinyobj::real_t vx = attrib.vertices[3*idx.vertex_index + 0];
-                tinyobj::real_t vy = attrib.vertices[3*idx.vertex_index + 1];
-                tinyobj::real_t vz = attrib.vertices[3*idx.vertex_index + 2];
-                vertex.position = vec4(vx, vy, vz, 1);
-
-                tinyobj::real_t nx = attrib.normals[3*idx.normal_index + 0];
-                tinyobj::real_t ny = attrib.normals[3*idx.normal_index + 1];
-                tinyobj::real_t nz = attrib.normals[3*idx.normal_index + 2];
-                vertex.normal =  vec4(nx, ny, nz, 0);
-
-                tinyobj::real_t u = attrib.texcoords[2*idx.texcoord_index+0];
-                tinyobj::real_t v = attrib.texcoords[2*idx.texcoord_index+1];
-                vertex.uv = vec2(u,v);
-
-                face.vertices.push_back(vertex);
-            }
-
-            faces.push_back(face);
-            startVertexIdxOfFace += vertexAmt;
-        }
-    }
-}
-
-
-Mesh::Mesh(std::string_view path)
-{
-    tinyobj::attrib_t                attrib;
-    std::vector<tinyobj::shape_t>    shapes;
-    std::vector<tinyobj::material_t> materials;
-    std::string                      err;  
-
-    // LoadObj now only passes in 1 std::string for error handling in release v1.0.6.
-    bool ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &err, path.data());
-
-    if (!err.empty())   { std::cerr << "Error: " << err << std::endl; } 
-    if (!ret)           { exit(1); }
-
-    parse_obj(attrib, shapes, materials);
-}
-
-Mesh::Mesh(std::string_view path, std::shared_ptr<Texture>& t)
-    : Mesh(path)
-{ 
-    texture = t;
-}
-
-void Mesh::setTexture(std::shared_ptr<Texture>& t)
-{
-    texture = t;
-}
-
-std::shared_ptr<Texture> Mesh::getTexture() const
-{
-    return texture;
-}
-
-void Mesh::setFaces(std::vector<Face>& f)
-{
-    faces = f;
-}
-
-std::vector<Face>& Mesh::getFaces()
-{
-    return faces;
+#include "vertex.h"
+#include "mesh.h"
+#include "mesh_optimizer.h"
+#include "mesh_simplifier.h"
+#include "obj_parser.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+
+namespace
+{
+    // The binary cache file: this header, then the ranges of the levels of detail, the 8 vertex streams back to back
+    // (as in Mesh::stream_data), and the indices, the meshlets and the meshlet vertices of every level.
+    // Everything is in the native byte order, which the magic number checks.
+    constexpr uint32_t MESH_CACHE_MAGIC = 0x4853454D; // "MESH" in little-endian.
+    // Bump this whenever the layout or the way OBJ files are turned into meshes changes, to invalidate old caches.
+    constexpr uint32_t MESH_CACHE_VERSION = 7;
+
+    struct MeshCacheHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t source_stamp;
+        uint64_t vertex_count;
+        uint64_t index_count;
+        float bounds_min[3];
+        float bounds_max[3];
+        float sphere_center[3];
+        float sphere_radius;
+        uint64_t meshlet_count;
+        uint64_t meshlet_vertex_count;
+        uint64_t lod_count;
+        uint64_t lods_offset; // In bytes from the start of the file.
+        uint64_t streams_offset;
+        uint64_t indices_offset;
+        uint64_t meshlets_offset;
+        uint64_t meshlet_vertices_offset;
+    };
+    static_assert(std::is_trivially_copyable<Meshlet>::value, "meshlets are written to the cache and mapped from it as raw bytes");
+
+    // Identifies one version of the source file by hashing its size and modification time, which is what build tools
+    // go by too. Hashing the contents instead would mean reading the whole OBJ on every start, which the cache is there to avoid.
+    // Returns 0 if the file can't be found.
+    uint64_t source_stamp(const std::string& path)
+    {
+        std::error_code error;
+        uint64_t size = std::filesystem::file_size(path, error);
+        if (error) return 0;
+        auto modified = std::filesystem::last_write_time(path, error);
+        if (error) return 0;
+
+        // FNV-1a over the bytes of both values.
+        const uint64_t values[2] = { size, (uint64_t) modified.time_since_epoch().count() };
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(values);
+        uint64_t hash = 14695981039346656037ULL;
+        for (size_t i = 0; i < sizeof(values); i++)
+        {
+            hash = (hash ^ bytes[i]) * 1099511628211ULL;
+        }
+        return hash != 0 ? hash : 1;
+    }
+
+    // Corners of different faces are the same vertex when they use the same position, normal and uv.
+    struct IndexKey
+    {
+        int vertex_index;
+        int normal_index;
+        int texcoord_index;
+
+        bool operator==(const IndexKey& other) const
+        {
+            return vertex_index == other.vertex_index && normal_index == other.normal_index && texcoord_index == other.texcoord_index;
+        }
+    };
+
+    struct IndexKeyHash
+    {
+        size_t operator()(const IndexKey& key) const
+        {
+            size_t h = std::hash<int>()(key.vertex_index);
+            h = (h * 31) + std::hash<int>()(key.normal_index);
+            h = (h * 31) + std::hash<int>()(key.texcoord_index);
+            return h;
+        }
+    };
+}
+
+// All vertices are stored in counter-clockwise order by default.
+void Mesh::parse_obj(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes, const std::vector<tinyobj::material_t>& materials)
+{
+    std::unordered_map<IndexKey, uint32_t, IndexKeyHash> unique_vertices;
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> triangle_indices;
+    std::vector<int> position_of_vertex; // The tinyobj vertex_index of each unique vertex.
+    std::vector<bool> missing_normal;
+    bool missing_normals = false;
+
+    int shapeAmt = shapes.size();
+
+    size_t corner_count = 0;
+    for (const tinyobj::shape_t& shape : shapes)
+    {
+        corner_count += shape.mesh.indices.size();
+    }
+    // Triangles have no more corners than the polygons they come from; closed meshes have about half as many vertices.
+    triangle_indices.reserve(corner_count);
+    vertices.reserve(corner_count / 2);
+    std::vector<uint32_t> face_indices;
+    
+    for (size_t s = 0; s < shapeAmt; s++)
+    {
+        int faceAmt = shapes[s].mesh.num_face_vertices.size();
+        size_t startVertexIdxOfFace = 0; // Vertices are not stored per face, but rather all in an array
+
+        for (size_t f = 0; f < faceAmt; f++)
+        {
+            int vertexAmt = shapes[s].mesh.num_face_vertices[f];
+            face_indices.clear();
+            
+            for (int vertexNum = 0; vertexNum < vertexAmt; vertexNum++)
+            {
+                tinyobj::index_t idx = shapes[s].mesh.indices[startVertexIdxOfFace + vertexNum]; 
+                IndexKey key = { idx.vertex_index, idx.normal_index, idx.texcoord_index };
+
+                auto [it, inserted] = unique_vertices.try_emplace(key, (uint32_t) vertices.size());
+                face_indices.push_back(it->second);
+                if (!inserted) continue;
+
+                Vertex vertex;
+
+                tinyobj::real_t vx = attrib.vertices[3*idx.vertex_index + 0];
+                tinyobj::real_t vy = attrib.vertices[3*idx.vertex_index + 1];
+                tinyobj::real_t vz = attrib.vertices[3*idx.vertex_index + 2];
+                vertex.position = vec4(vx, vy, vz, 1);
+
+                // Not every OBJ has normals or uvs (teapot.obj has neither), in which case the index is -1.
+                if (idx.normal_index >= 0)
+                {
+                    tinyobj::real_t nx = attrib.normals[3*idx.normal_index + 0];
+                    tinyobj::real_t ny = attrib.normals[3*idx.normal_index + 1];
+                    tinyobj::real_t nz = attrib.normals[3*idx.normal_index + 2];
+                    vertex.normal =  vec4(nx, ny, nz, 0);
+                } else
+                {
+                    missing_normals = true;
+                }
+
+                if (idx.texcoord_index >= 0)
+                {
+                    tinyobj::real_t u = attrib.texcoords[2*idx.texcoord_index+0];
+                    tinyobj::real_t v = attrib.texcoords[2*idx.texcoord_index+1];
+                    vertex.uv = vec2(u,v);
+                }
+
+                vertices.push_back(vertex);
+                position_of_vertex.push_back(idx.vertex_index);
+                missing_normal.push_back(idx.normal_index < 0);
+            }
+
+            // Polygons become a fan of triangles around their first corner.
+            for (int i = 1; i + 1 < vertexAmt; i++)
+            {
+                triangle_indices.push_back(face_indices[0]);
+                triangle_indices.push_back(face_indices[i]);
+                triangle_indices.push_back(face_indices[i + 1]);
+            }
+
+            startVertexIdxOfFace += vertexAmt;
+        }
+    }
+
+    if (missing_normals)
+    {
+        // Make up smooth normals: every triangle adds its area-weighted normal to each position it touches.
+        std::vector<vec3> position_normals(attrib.vertices.size() / 3);
+        for (size_t i = 0; i < triangle_indices.size(); i += 3)
+        {
+            vec3 p0 = vertices[triangle_indices[i]].position;
+            vec3 p1 = vertices[triangle_indices[i + 1]].position;
+            vec3 p2 = vertices[triangle_indices[i + 2]].position;
+            vec3 n = cross(p1 - p0, p2 - p0);
+            for (int k = 0; k < 3; k++)
+            {
+                position_normals[position_of_vertex[triangle_indices[i + k]]] += n;
+            }
+        }
+
+        for (size_t v = 0; v < vertices.size(); v++)
+        {
+            vec3 n = position_normals[position_of_vertex[v]];
+            if (missing_normal[v] && n.length() > 0)
+            {
+                n.normalize_inplace();
+                vertices[v].normal = vec4(n.x, n.y, n.z, 0);
+            }
+        }
+    }
+
+    set_geometry(vertices, std::move(triangle_indices));
+}
+
+// Packs the vertices into streams, which the mesh owns from now on.
+void Mesh::set_geometry(const std::vector<Vertex>& vertices, std::vector<uint32_t> new_indices)
+{
+    size_t n = vertices.size();
+    stream_data.resize(n * 8);
+    float* x = stream_data.data();
+    for (size_t i = 0; i < n; i++)
+    {
+        const Vertex& vertex = vertices[i];
+        x[i] = vertex.position.x;
+        x[n + i] = vertex.position.y;
+        x[(2 * n) + i] = vertex.position.z;
+        x[(3 * n) + i] = vertex.normal.x;
+        x[(4 * n) + i] = vertex.normal.y;
+        x[(5 * n) + i] = vertex.normal.z;
+        x[(6 * n) + i] = vertex.uv.x;
+        x[(7 * n) + i] = vertex.uv.y;
+    }
+    index_data = std::move(new_indices);
+    cache.reset();
+    meshlet_data = std::vector<Meshlet>();
+    meshlet_vertex_data = std::vector<uint32_t>();
+    meshlets = ArrayView<Meshlet>();
+    meshlet_vertices = ArrayView<uint32_t>();
+    lod_range_data = std::vector<LodRange>();
+    lod_ranges = ArrayView<LodRange>();
+
+    set_views(stream_data.data(), n, index_data.data(), index_data.size());
+    set_lods();
+
+    bounds = AABB();
+    bounding_sphere = BoundingSphere();
+    if (n == 0) return;
+    bounds.min = bounds.max = vec3(x[0], x[n], x[2 * n]);
+    for (size_t i = 1; i < n; i++)
+    {
+        bounds.min = vec3(std::min(bounds.min.x, x[i]), std::min(bounds.min.y, x[n + i]), std::min(bounds.min.z, x[(2 * n) + i]));
+        bounds.max = vec3(std::max(bounds.max.x, x[i]), std::max(bounds.max.y, x[n + i]), std::max(bounds.max.z, x[(2 * n) + i]));
+    }
+
+    bounding_sphere.center = bounds.center();
+    float radius_squared = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        vec3 offset = vec3(x[i], x[n + i], x[(2 * n) + i]) - bounding_sphere.center;
+        radius_squared = std::max(radius_squared, dot(offset, offset));
+    }
+    bounding_sphere.radius = std::sqrt(radius_squared);
+}
+
+void Mesh::set_views(const float* stream_values, size_t vertex_count, const uint32_t* index_values, size_t index_count)
+{
+    ArrayView<float>* views[] = { &streams.x, &streams.y, &streams.z, &streams.nx, &streams.ny, &streams.nz, &streams.u, &streams.v };
+    for (size_t k = 0; k < 8; k++)
+    {
+        *views[k] = ArrayView<float>(stream_values + (k * vertex_count), vertex_count);
+    }
+    indices = ArrayView<uint32_t>(index_values, index_count);
+}
+
+// Points lods at the data of each level, as lod_ranges describes it.
+void Mesh::set_lods()
+{
+    lods.clear();
+    if (lod_ranges.empty())
+    {
+        lods.push_back({ streams.size(), indices, meshlets, meshlet_vertices, 0 });
+        return;
+    }
+
+    for (const LodRange& range : lod_ranges)
+    {
+        lods.push_back({ (size_t) range.vertex_count,
+                         indices.subview(range.index_offset, range.index_count),
+                         meshlets.subview(range.meshlet_offset, range.meshlet_count),
+                         meshlet_vertices.subview(range.meshlet_vertex_offset, range.meshlet_vertex_count),
+                         range.error });
+    }
+}
+
+// Maps the cache and points the views straight into it. Returns false, leaving the mesh alone,
+// if there is no cache or it doesn't belong to the current version of the OBJ file.
+bool Mesh::load_cache(const std::string& cache_path, uint64_t source_stamp)
+{
+    std::unique_ptr<MappedFile> file = MappedFile::open(cache_path);
+    if (file == nullptr || file->size() < sizeof(MeshCacheHeader)) return false;
+
+    MeshCacheHeader header;
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (header.magic != MESH_CACHE_MAGIC || header.version != MESH_CACHE_VERSION || header.source_stamp != source_stamp) return false;
+
+    uint64_t streams_end = header.streams_offset + (header.vertex_count * 8 * sizeof(float));
+    uint64_t indices_end = header.indices_offset + (header.index_count * sizeof(uint32_t));
+    uint64_t meshlets_end = header.meshlets_offset + (header.meshlet_count * sizeof(Meshlet));
+    uint64_t meshlet_vertices_end = header.meshlet_vertices_offset + (header.meshlet_vertex_count * sizeof(uint32_t));
+    uint64_t lods_end = header.lods_offset + (header.lod_count * sizeof(LodRange));
+    if (header.streams_offset % alignof(float) != 0 || header.indices_offset % alignof(uint32_t) != 0) return false;
+    if (header.meshlets_offset % alignof(Meshlet) != 0 || header.meshlet_vertices_offset % alignof(uint32_t) != 0) return false;
+    if (header.lods_offset % alignof(LodRange) != 0) return false;
+    if (streams_end > file->size() || indices_end > file->size() || header.index_count % 3 != 0) return false;
+    if (meshlets_end > file->size() || meshlet_vertices_end > file->size() || lods_end > file->size()) return false;
+
+    const uint8_t* bytes = file->data();
+    static_assert(std::is_trivially_copyable<LodRange>::value, "level of detail ranges are written to the cache and mapped from it as raw bytes");
+    ArrayView<LodRange> ranges(reinterpret_cast<const LodRange*>(bytes + header.lods_offset), (size_t) header.lod_count);
+    for (const LodRange& range : ranges)
+    {
+        if (range.vertex_count > header.vertex_count) return false;
+        if (range.index_offset + range.index_count > header.index_count || range.index_count % 3 != 0) return false;
+        if (range.meshlet_offset + range.meshlet_count > header.meshlet_count) return false;
+        if (range.meshlet_vertex_offset + range.meshlet_vertex_count > header.meshlet_vertex_count) return false;
+    }
+
+    set_views(reinterpret_cast<const float*>(bytes + header.streams_offset), (size_t) header.vertex_count,
+              reinterpret_cast<const uint32_t*>(bytes + header.indices_offset), (size_t) header.index_count);
+    bounds.min = vec3(header.bounds_min[0], header.bounds_min[1], header.bounds_min[2]);
+    bounds.max = vec3(header.bounds_max[0], header.bounds_max[1], header.bounds_max[2]);
+    bounding_sphere.center = vec3(header.sphere_center[0], header.sphere_center[1], header.sphere_center[2]);
+    bounding_sphere.radius = header.sphere_radius;
+    meshlets = ArrayView<Meshlet>(reinterpret_cast<const Meshlet*>(bytes + header.meshlets_offset), (size_t) header.meshlet_count);
+    meshlet_vertices = ArrayView<uint32_t>(reinterpret_cast<const uint32_t*>(bytes + header.meshlet_vertices_offset), (size_t) header.meshlet_vertex_count);
+    lod_ranges = ranges;
+    set_lods();
+
+    stream_data = std::vector<float>();
+    index_data = std::vector<uint32_t>();
+    meshlet_data = std::vector<Meshlet>();
+    meshlet_vertex_data = std::vector<uint32_t>();
+    lod_range_data = std::vector<LodRange>();
+    cache = std::move(file);
+    return true;
+}
+
+// Written to a temporary file that is then renamed over the cache, so that a run that is interrupted
+// halfway never leaves a broken cache behind. Failing to write it only costs the next run a parse.
+void Mesh::write_cache(const std::string& cache_path, uint64_t source_stamp) const
+{
+    MeshCacheHeader header;
+    header.magic = MESH_CACHE_MAGIC;
+    header.version = MESH_CACHE_VERSION;
+    header.source_stamp = source_stamp;
+    header.vertex_count = streams.size();
+    header.index_count = indices.size();
+    header.bounds_min[0] = bounds.min.x;
+    header.bounds_min[1] = bounds.min.y;
+    header.bounds_min[2] = bounds.min.z;
+    header.bounds_max[0] = bounds.max.x;
+    header.bounds_max[1] = bounds.max.y;
+    header.bounds_max[2] = bounds.max.z;
+    header.sphere_center[0] = bounding_sphere.center.x;
+    header.sphere_center[1] = bounding_sphere.center.y;
+    header.sphere_center[2] = bounding_sphere.center.z;
+    header.sphere_radius = bounding_sphere.radius;
+    header.meshlet_count = meshlets.size();
+    header.meshlet_vertex_count = meshlet_vertices.size();
+    header.lod_count = lod_ranges.size();
+    header.lods_offset = sizeof(MeshCacheHeader);
+    header.streams_offset = header.lods_offset + (header.lod_count * sizeof(LodRange));
+    header.indices_offset = header.streams_offset + (header.vertex_count * 8 * sizeof(float));
+    header.meshlets_offset = header.indices_offset + (header.index_count * sizeof(uint32_t));
+    header.meshlet_vertices_offset = header.meshlets_offset + (header.meshlet_count * sizeof(Meshlet));
+
+    std::string temp_path = cache_path + ".tmp";
+    {
+        std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(lod_range_data.data()), lod_range_data.size() * sizeof(LodRange));
+        out.write(reinterpret_cast<const char*>(stream_data.data()), stream_data.size() * sizeof(float));
+        out.write(reinterpret_cast<const char*>(index_data.data()), index_data.size() * sizeof(uint32_t));
+        out.write(reinterpret_cast<const char*>(meshlet_data.data()), meshlet_data.size() * sizeof(Meshlet));
+        out.write(reinterpret_cast<const char*>(meshlet_vertex_data.data()), meshlet_vertex_data.size() * sizeof(uint32_t));
+        if (out.good()) out.close();
+        if (!out.good())
+        {
+            std::cerr << "Could not write the mesh cache " << cache_path << std::endl;
+            std::remove(temp_path.c_str());
+            return;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temp_path, cache_path, error);
+    if (error)
+    {
+        std::cerr << "Could not write the mesh cache " << cache_path << ": " << error.message() << std::endl;
+        std::remove(temp_path.c_str());
+    }
+}
+
+Mesh::Mesh(std::string_view path)
+{
+    std::string obj_path(path);
+    std::string cache_path = mesh_cache_path(path);
+    uint64_t stamp = source_stamp(obj_path);
+    if (stamp != 0 && load_cache(cache_path, stamp)) return;
+
+    tinyobj::attrib_t                attrib;
+    std::vector<tinyobj::shape_t>    shapes(1);
+    std::vector<tinyobj::material_t> materials;
+
+    if (!parse_obj_parallel(obj_path, ThreadPool::shared(), attrib, shapes[0]))
+    {
+        std::cerr << "Error: could not read " << obj_path << std::endl;
+        exit(1);
+    }
+
+    parse_obj(attrib, shapes, materials);
+    MeshOptimizationStats stats = optimize();
+    std::cout << "Optimized " << obj_path << ": ";
+    stats.print();
+    buildLods();
+    std::cout << "Levels of detail of " << obj_path << ":";
+    for (const MeshLod& lod : lods)
+    {
+        std::cout << " " << lod.indices.size() / 3 << " triangles (error " << lod.error << ")";
+    }
+    std::cout << std::endl;
+    if (stamp != 0) write_cache(cache_path, stamp);
+}
+
+Mesh::Mesh(std::string_view path, std::shared_ptr<Texture>& t)
+    : Mesh(path)
+{ 
+    texture = t;
+}
+
+void Mesh::setTexture(std::shared_ptr<Texture>& t)
+{
+    texture = t;
+}
+
+std::shared_ptr<Texture> Mesh::getTexture() const
+{
+    return texture;
+}
+
+// Triangle lists handed to us directly don't come with indices, so identical vertices are merged here instead.
+void Mesh::setTriangles(const std::vector<Vertex>& corners)
+{
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> triangle_indices;
+    triangle_indices.reserve(corners.size() - (corners.size() % 3));
+
+    // Keyed on the raw bytes of the attributes, so only exact copies are merged.
+    // Vertex itself has alignment padding, which must not take part in the comparison.
+    std::unordered_map<std::string, uint32_t> unique_vertices;
+
+    for (size_t i = 0; i + 2 < corners.size(); i += 3)
+    {
+        for (size_t k = i; k < i + 3; k++)
+        {
+            const Vertex& vertex = corners[k];
+            const float attributes[] = {
+                vertex.position.x, vertex.position.y, vertex.position.z,
+                vertex.normal.x, vertex.normal.y, vertex.normal.z,
+                vertex.uv.x, vertex.uv.y
+            };
+            std::string key(reinterpret_cast<const char*>(attributes), sizeof(attributes));
+            auto [it, inserted] = unique_vertices.try_emplace(key, (uint32_t) vertices.size());
+            if (inserted) vertices.push_back(vertex);
+            triangle_indices.push_back(it->second);
+        }
+    }
+
+    set_geometry(vertices, std::move(triangle_indices));
+}
+
+size_t Mesh::getVertexCount() const
+{
+    return streams.size();
+}
+
+Vertex Mesh::getVertex(size_t index) const
+{
+    Vertex vertex;
+    vertex.position = vec4(streams.x[index], streams.y[index], streams.z[index], 1);
+    vertex.normal = vec4(streams.nx[index], streams.ny[index], streams.nz[index], 0);
+    vertex.uv = vec2(streams.u[index], streams.v[index]);
+    return vertex;
+}
+
+const VertexStreams& Mesh::getVertexStreams() const
+{
+    return streams;
+}
+
+ArrayView<uint32_t> Mesh::getIndices() const
+{
+    return lods[0].indices;
+}
+
+size_t Mesh::getTriangleCount() const
+{
+    return lods[0].indices.size() / 3;
+}
+
+ArrayView<Meshlet> Mesh::getMeshlets() const
+{
+    return lods[0].meshlets;
+}
+
+ArrayView<uint32_t> Mesh::getMeshletVertices() const
+{
+    return lods[0].meshlet_vertices;
+}
+
+size_t Mesh::getLodCount() const
+{
+    return lods.size();
+}
+
+const MeshLod& Mesh::getLod(size_t level) const
+{
+    return lods[level];
+}
+
+const AABB& Mesh::getBounds() const
+{
+    return bounds;
+}
+
+const BoundingSphere& Mesh::getBoundingSphere() const
+{
+    return bounding_sphere;
+}
+
+float Mesh::acmr(int cache_size) const
+{
+    return analyze_acmr(getIndices(), getVertexCount(), cache_size);
+}
+
+float Mesh::overdraw() const
+{
+    return analyze_overdraw(getIndices(), streams);
+}
+
+MeshOptimizationStats Mesh::optimize()
+{
+    MeshOptimizationStats stats;
+    stats.acmr_before = acmr();
+    stats.overdraw_before = overdraw();
+
+    std::vector<uint32_t> new_indices = optimize_vertex_cache(getIndices(), getVertexCount(), VERTEX_CACHE_SIZE);
+    optimize_overdraw(new_indices, streams, VERTEX_CACHE_SIZE);
+    std::vector<uint32_t> new_meshlet_vertices;
+    std::vector<Meshlet> new_meshlets = build_meshlets(new_indices, streams, new_meshlet_vertices, VERTEX_CACHE_SIZE);
+
+    // On meshes that come in a good order already, the meshlets' grouping can cost more cache misses than the reordering
+    // saved. Those keep their own order, cut into meshlets as it comes.
+    if (analyze_acmr(ArrayView<uint32_t>(new_indices.data(), new_indices.size()), getVertexCount(), VERTEX_CACHE_SIZE) > stats.acmr_before)
+    {
+        new_indices.assign(getIndices().begin(), getIndices().end());
+        new_meshlets = split_meshlets(new_indices, streams, new_meshlet_vertices);
+    }
+    std::vector<uint32_t> old_index = optimize_vertex_fetch(new_indices, getVertexCount());
+
+    std::vector<uint32_t> new_index(getVertexCount());
+    std::vector<Vertex> vertices;
+    vertices.reserve(old_index.size());
+    for (uint32_t v : old_index)
+    {
+        new_index[v] = (uint32_t) vertices.size();
+        vertices.push_back(getVertex(v));
+    }
+    for (uint32_t& v : new_meshlet_vertices)
+    {
+        v = new_index[v];
+    }
+    set_geometry(vertices, std::move(new_indices));
+
+    meshlet_data = std::move(new_meshlets);
+    meshlet_vertex_data = std::move(new_meshlet_vertices);
+    meshlets = ArrayView<Meshlet>(meshlet_data.data(), meshlet_data.size());
+    meshlet_vertices = ArrayView<uint32_t>(meshlet_vertex_data.data(), meshlet_vertex_data.size());
+    set_lods();
+
+    stats.acmr_after = acmr();
+    stats.overdraw_after = overdraw();
+    return stats;
+}
+
+// Level 0 is copied over as it is. The others are simplified from it, and since they only use its vertices,
+// they share its vertex streams and only add indices and meshlets.
+// The vertices are then renumbered so that each level only uses a prefix of them, and the vertex stage needn't look
+// at the rest: first the coarsest level's, in the order it uses them, then those that each finer level adds.
+// Within a level, vertices are still fetched roughly in order, though level 0 loses some of the locality optimize() gave it.
+void Mesh::buildLods()
+{
+    const MeshLod& full = lods[0];
+    std::vector<uint32_t> new_indices(full.indices.begin(), full.indices.end());
+    std::vector<Meshlet> new_meshlets(full.meshlets.begin(), full.meshlets.end());
+    std::vector<uint32_t> new_meshlet_vertices(full.meshlet_vertices.begin(), full.meshlet_vertices.end());
+    std::vector<LodRange> ranges;
+    ranges.push_back({ 0, 0, new_indices.size(), 0, new_meshlets.size(), 0, new_meshlet_vertices.size(), 0 });
+
+    for (const SimplifiedLevel& level : simplify_lods(full.indices, streams, MAX_LODS, MIN_LOD_TRIANGLES))
+    {
+        std::vector<uint32_t> level_indices = optimize_vertex_cache(ArrayView<uint32_t>(level.indices.data(), level.indices.size()),
+                                                                    getVertexCount(), VERTEX_CACHE_SIZE);
+        optimize_overdraw(level_indices, streams, VERTEX_CACHE_SIZE);
+        std::vector<uint32_t> level_meshlet_vertices;
+        std::vector<Meshlet> level_meshlets = build_meshlets(level_indices, streams, level_meshlet_vertices, VERTEX_CACHE_SIZE);
+
+        ranges.push_back({ 0, new_indices.size(), level_indices.size(), new_meshlets.size(), level_meshlets.size(),
+                           new_meshlet_vertices.size(), level_meshlet_vertices.size(), level.error });
+        new_indices.insert(new_indices.end(), level_indices.begin(), level_indices.end());
+        new_meshlets.insert(new_meshlets.end(), level_meshlets.begin(), level_meshlets.end());
+        new_meshlet_vertices.insert(new_meshlet_vertices.end(), level_meshlet_vertices.begin(), level_meshlet_vertices.end());
+    }
+
+    size_t n = getVertexCount();
+    std::vector<uint32_t> new_index(n, UINT32_MAX);
+    uint32_t numbered = 0;
+    for (size_t level = ranges.size(); level-- > 0;)
+    {
+        for (size_t i = ranges[level].index_offset; i < ranges[level].index_offset + ranges[level].index_count; i++)
+        {
+            if (new_index[new_indices[i]] == UINT32_MAX) new_index[new_indices[i]] = numbered++;
+        }
+        ranges[level].vertex_count = numbered;
+    }
+    for (uint32_t& v : new_index)
+    {
+        if (v == UINT32_MAX) v = numbered++;
+    }
+    for (uint32_t& v : new_indices) v = new_index[v];
+    for (uint32_t& v : new_meshlet_vertices) v = new_index[v];
+
+    const ArrayView<float> old_streams[] = { streams.x, streams.y, streams.z, streams.nx, streams.ny, streams.nz, streams.u, streams.v };
+    std::vector<float> new_stream_data(n * 8);
+    for (size_t k = 0; k < 8; k++)
+    {
+        for (size_t v = 0; v < n; v++)
+        {
+            new_stream_data[(k * n) + new_index[v]] = old_streams[k][v];
+        }
+    }
+
+    stream_data = std::move(new_stream_data);
+    index_data = std::move(new_indices);
+    meshlet_data = std::move(new_meshlets);
+    meshlet_vertex_data = std::move(new_meshlet_vertices);
+    lod_range_data = std::move(ranges);
+    set_views(stream_data.data(), n, index_data.data(), index_data.size());
+    cache.reset();
+    meshlets = ArrayView<Meshlet>(meshlet_data.data(), meshlet_data.size());
+    meshlet_vertices = ArrayView<uint32_t>(meshlet_vertex_data.data(), meshlet_vertex_data.size());
+    lod_ranges = ArrayView<LodRange>(lod_range_data.data(), lod_range_data.size());
+    set_lods();
+}
+
+std::string mesh_cache_path(std::string_view obj_path)
+{
+    std::filesystem::path path(obj_path);
+    path.replace_extension(".meshcache");
+    return path.string();
 }
\ No newline at end of file
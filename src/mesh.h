@@ -1,31 +1,211 @@
-#pragma once
-#include "vec2.h"
-#include "vec3.h"
-#include "vec4.h"
-#include "face.h"
-#include <memory>
-#include <vector>
-#include <string_view>
-#include "../ext/tiny_obj_loader.h"
-
-class Mesh
-{
-    private:
-        std::vector<Face> faces;
-        std::shared_ptr<Texture> texture = nullptr;
-
-    private: 
-        void parse_obj(const tinyobj::attrib_t& attribs, const std::vector<tinyobj::shape_t>& shapes, const std::vector<tinyobj::material_t>& materials);
-        
-    public:
-        Mesh() = default;
-        Mesh(std::string_view path);
-        Mesh(std::string_view path, std::shared_ptr<Texture>& t);
-
-        void setTexture(std::shared_ptr<Texture>& t);
-		std::shared_ptr<Texture> getTexture() const;
-
-        void setFaces(std::vector<Face>& f);
-        // TODO: Make const, with refactor of rasterizer
-        std::vector<Face>& getFaces();
-};
+#pragma once
+#include "vec2.h"
+#include "vec3.h"
+#include "vec4.h"
+#include "vertex.h"
+#include "bounds.h"
+#include "mapped_file.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <string_view>
+#include "../ext/tiny_obj_loader.h"
+
+struct MeshOptimizationStats;
+
+// A read-only view of consecutive values, which live either in the mesh's own arrays or in its mapped cache file.
+template <typename T>
+class ArrayView
+{
+    public:
+        ArrayView() = default;
+        ArrayView(const T* data, size_t count) :
+            ptr(data), count(count)
+        {
+        }
+
+        const T* data() const { return ptr; }
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+        const T* begin() const { return ptr; }
+        const T* end() const { return ptr + count; }
+        const T& operator[](size_t i) const { return ptr[i]; }
+
+        ArrayView subview(size_t offset, size_t length) const { return ArrayView(ptr + offset, length); }
+
+    private:
+        const T* ptr = nullptr;
+        size_t count = 0;
+};
+
+// The vertex buffer split into one array per attribute component (structure of arrays), so that the batched
+// vertex stage can load the same component of several neighbouring vertices into one SIMD register.
+struct VertexStreams
+{
+    ArrayView<float> x, y, z;    // Positions, whose w is always 1.
+    ArrayView<float> nx, ny, nz; // Normals, whose w is always 0.
+    ArrayView<float> u, v;
+
+    size_t size() const
+    {
+        return x.size();
+    }
+
+    // The vertices [offset, offset + count).
+    VertexStreams slice(size_t offset, size_t count) const
+    {
+        return { x.subview(offset, count), y.subview(offset, count), z.subview(offset, count),
+                 nx.subview(offset, count), ny.subview(offset, count), nz.subview(offset, count),
+                 u.subview(offset, count), v.subview(offset, count) };
+    }
+};
+
+// A small cluster of neighbouring triangles that face about the same way, with bounds that let the renderer
+// cull it as a whole before transforming any of its vertices. Everything is in object space.
+struct Meshlet
+{
+    static constexpr uint32_t MAX_VERTICES = 64;
+    static constexpr uint32_t MAX_TRIANGLES = 124;
+
+    uint32_t triangle_offset; // The meshlet's triangles are consecutive in the mesh's indices, starting at this triangle.
+    uint32_t triangle_count;
+    uint32_t vertex_offset;   // The distinct vertices the triangles use are listed consecutively in the mesh's meshlet vertices.
+    uint32_t vertex_count;
+
+    vec3 center; // Bounding sphere.
+    float radius;
+
+    // Normal cone: seen from a point p, every triangle faces away if dot(normalize(cone_apex - p), cone_axis) > cone_cutoff.
+    // cone_cutoff is above 1 when the triangles face too many ways for the test to ever succeed.
+    vec3 cone_apex;
+    vec3 cone_axis;
+    float cone_cutoff;
+
+    bool backfacing(const vec3& eye) const
+    {
+        vec3 to_apex = cone_apex - eye;
+        return dot(to_apex, cone_axis) > cone_cutoff * to_apex.length();
+    }
+};
+
+// One level of detail: the mesh itself, or a simplified version of it that uses a subset of its vertices,
+// with its own triangles and meshlets. The meshlets' offsets are into the level's own indices and meshlet vertices.
+struct MeshLod
+{
+    size_t vertex_count = 0; // The level only uses the mesh's first vertex_count vertices.
+    ArrayView<uint32_t> indices;
+    ArrayView<Meshlet> meshlets;
+    ArrayView<uint32_t> meshlet_vertices;
+    float error = 0; // How far, in object space, the level's surface is from the full mesh (see simplify_lods).
+};
+
+class Mesh
+{
+    private:
+        std::shared_ptr<Texture> texture = nullptr;
+
+        // Triangles are stored indexed, in flat arrays: every distinct vertex is stored once, as streams,
+        // and each consecutive group of 3 indices makes up a triangle. Polygons are triangulated on load.
+        // The views point into stream_data and index_data, or straight into the mapped cache file.
+        // indices holds the triangles of every level of detail, level 0 first.
+        VertexStreams streams;
+        ArrayView<uint32_t> indices;
+        std::vector<float> stream_data; // The 8 streams back to back: x, y, z, nx, ny, nz, u, v.
+        std::vector<uint32_t> index_data;
+        std::unique_ptr<MappedFile> cache;
+
+        // Only meshes that have been optimized are split into meshlets; otherwise these are empty.
+        ArrayView<Meshlet> meshlets;
+        ArrayView<uint32_t> meshlet_vertices;
+        std::vector<Meshlet> meshlet_data;
+        std::vector<uint32_t> meshlet_vertex_data;
+
+        // Where each level of detail's data is, in the arrays above. Without any ranges, the mesh only has level 0,
+        // which is all of them. lods holds the views that the ranges describe, and always has level 0.
+        struct LodRange
+        {
+            uint64_t vertex_count;
+            uint64_t index_offset;
+            uint64_t index_count;
+            uint64_t meshlet_offset;
+            uint64_t meshlet_count;
+            uint64_t meshlet_vertex_offset;
+            uint64_t meshlet_vertex_count;
+            float error;
+        };
+        ArrayView<LodRange> lod_ranges;
+        std::vector<LodRange> lod_range_data;
+        std::vector<MeshLod> lods = std::vector<MeshLod>(1);
+
+        AABB bounds;
+        BoundingSphere bounding_sphere;
+
+    private: 
+        void parse_obj(const tinyobj::attrib_t& attribs, const std::vector<tinyobj::shape_t>& shapes, const std::vector<tinyobj::material_t>& materials);
+        void set_geometry(const std::vector<Vertex>& vertices, std::vector<uint32_t> new_indices);
+        void set_views(const float* stream_values, size_t vertex_count, const uint32_t* index_values, size_t index_count);
+        void set_lods();
+        bool load_cache(const std::string& cache_path, uint64_t source_stamp);
+        void write_cache(const std::string& cache_path, uint64_t source_stamp) const;
+        
+    public:
+        Mesh() = default;
+        // Loads an OBJ file. The result is cached in a binary file next to it (see mesh_cache_path), which later loads
+        // map into memory and use as is, for as long as the OBJ's size and modification time stay the same.
+        Mesh(std::string_view path);
+        Mesh(std::string_view path, std::shared_ptr<Texture>& t);
+
+        // The views may point into a mapping that is owned by this mesh alone.
+        Mesh(const Mesh&) = delete;
+        Mesh& operator=(const Mesh&) = delete;
+
+        void setTexture(std::shared_ptr<Texture>& t);
+		std::shared_ptr<Texture> getTexture() const;
+
+        // Replaces the geometry with a plain triangle list, where each consecutive group of 3 corners makes up a triangle.
+        // Positions are taken to be points (w = 1) and normals directions (w = 0).
+        void setTriangles(const std::vector<Vertex>& corners);
+
+        size_t getVertexCount() const;
+        // Assembled from the streams.
+        Vertex getVertex(size_t index) const;
+        const VertexStreams& getVertexStreams() const;
+        // Those of the full mesh, level of detail 0.
+        ArrayView<uint32_t> getIndices() const;
+        size_t getTriangleCount() const;
+        ArrayView<Meshlet> getMeshlets() const;
+        ArrayView<uint32_t> getMeshletVertices() const;
+
+        // Level 0 is the full mesh, and every further level has at most half the triangles of the one before.
+        size_t getLodCount() const;
+        const MeshLod& getLod(size_t level) const;
+
+        // Bounds of the vertices, in object space, computed once when the geometry is set and kept in the cache.
+        // The sphere is centered on the box and just reaches the farthest vertex.
+        const AABB& getBounds() const;
+        const BoundingSphere& getBoundingSphere() const;
+
+        // Average cache miss ratio: vertex shader runs per triangle when the post-transform results
+        // are kept in a FIFO cache of the given size. 3 is the worst case; ~0.5 is the best a closed mesh can do.
+        float acmr(int cache_size = VERTEX_CACHE_SIZE) const;
+        // Fragments shaded per covered pixel, seen from the 6 sides of the mesh (see analyze_overdraw).
+        float overdraw() const;
+
+        // Reorders the triangles and vertices for vertex cache reuse, less overdraw and fetch locality,
+        // and splits the triangles into meshlets (see mesh_optimizer.h). Meshes loaded from OBJ files are optimized before they are cached.
+        // Drops any levels of detail but the full mesh.
+        MeshOptimizationStats optimize();
+
+        // Replaces the levels of detail past the full mesh with a chain of ever simpler ones (see simplify_lods),
+        // each optimized and split into meshlets like the full mesh. Meshes loaded from OBJ files get them before they are cached.
+        void buildLods();
+
+        static constexpr int VERTEX_CACHE_SIZE = 32;
+        // Levels of detail past the full mesh, at most, and the fewest triangles a level may have.
+        static constexpr size_t MAX_LODS = 7;
+        static constexpr size_t MIN_LOD_TRIANGLES = 64;
+};
+
+// Where the binary cache of the OBJ file at obj_path goes: the same path with the extension replaced by .meshcache.
+std::string mesh_cache_path(std::string_view obj_path);
@@ -0,0 +1,711 @@
+#include "mesh_optimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <unordered_map>
+
+namespace
+{
+    // A cluster is split where its ACMR so far has come down to within this factor of the ACMR of the whole cluster.
+    constexpr float SOFT_BOUNDARY_THRESHOLD = 1.1f;
+
+    // How much build_meshlets weighs a candidate triangle facing away from the meshlet so far (1 - the cosine between their normals),
+    // and its distance from the meshlet's centroid in expected meshlet radii, against the number of vertices it adds.
+    constexpr float MESHLET_CONE_WEIGHT = 2.0f;
+    constexpr float MESHLET_DISTANCE_WEIGHT = 0.5f;
+
+    // Once a meshlet has MESHLET_SMALL_TRIANGLES, a triangle only joins it if its normal is at least this close (the cosine)
+    // to the meshlet's average normal, since a wider cone would rarely face away. Smaller meshlets take any neighbour,
+    // weighing how far it turns their normal like the other costs, and else the next triangle in order: culling many
+    // tiny meshlets would cost about as much as the vertex stage it saves.
+    constexpr float MESHLET_MIN_JOIN_COSINE = 0.95f;
+    constexpr size_t MESHLET_SMALL_TRIANGLES = Meshlet::MAX_TRIANGLES / 4;
+
+    // Normals spread further than this (the cosine to the cone axis) make a cone too wide to ever cull.
+    constexpr float MESHLET_MIN_CONE_COSINE = 0.1f;
+
+    // Widens every normal cone slightly, so that rounding can't cull a meshlet with a triangle that is just barely visible.
+    constexpr float MESHLET_CONE_MARGIN = 1e-3f;
+
+    constexpr uint32_t NO_INDEX = std::numeric_limits<uint32_t>::max();
+
+    // Resolution of the views that analyze_overdraw renders.
+    constexpr int OVERDRAW_VIEWPORT = 256;
+
+    // A FIFO cache of post-transform vertices, like the ones in GPUs. A vertex is in the cache if fewer than
+    // cache_size misses happened since its own, so no queue needs to be kept.
+    class VertexCacheSimulator
+    {
+        public:
+            VertexCacheSimulator(size_t vertex_count, int cache_size) :
+                cache_size(cache_size), miss_time(vertex_count, 0), time(cache_size + 1)
+            {
+            }
+
+            // Returns how many of the triangle's vertices had to be transformed.
+            int add_triangle(const uint32_t* triangle)
+            {
+                int misses = 0;
+                for (int k = 0; k < 3; k++)
+                {
+                    uint32_t v = triangle[k];
+                    if (time - miss_time[v] > (size_t) cache_size)
+                    {
+                        miss_time[v] = time++;
+                        misses++;
+                    }
+                }
+                return misses;
+            }
+
+            void flush()
+            {
+                time += cache_size + 1;
+            }
+
+        private:
+            int cache_size;
+            std::vector<size_t> miss_time;
+            size_t time;
+    };
+
+    // Vertices with bitwise equal positions are the same point on the surface, whatever their other attributes.
+    struct PositionKey
+    {
+        uint32_t bits[3];
+
+        bool operator==(const PositionKey& other) const
+        {
+            return bits[0] == other.bits[0] && bits[1] == other.bits[1] && bits[2] == other.bits[2];
+        }
+    };
+
+    struct PositionKeyHash
+    {
+        size_t operator()(const PositionKey& key) const
+        {
+            size_t h = std::hash<uint32_t>()(key.bits[0]);
+            h = (h * 31) + std::hash<uint32_t>()(key.bits[1]);
+            h = (h * 31) + std::hash<uint32_t>()(key.bits[2]);
+            return h;
+        }
+    };
+
+    // For every vertex, the triangles that use it, in one array with offsets (compressed sparse rows).
+    struct VertexTriangles
+    {
+        std::vector<uint32_t> offsets;
+        std::vector<uint32_t> triangles;
+
+        VertexTriangles(ArrayView<uint32_t> indices, size_t vertex_count) :
+            offsets(vertex_count + 1, 0), triangles(indices.size())
+        {
+            for (uint32_t v : indices) offsets[v + 1]++;
+            for (size_t v = 0; v < vertex_count; v++) offsets[v + 1] += offsets[v];
+
+            std::vector<uint32_t> filled(offsets.begin(), offsets.end() - 1);
+            for (size_t i = 0; i < indices.size(); i++)
+            {
+                triangles[filled[indices[i]]++] = (uint32_t) (i / 3);
+            }
+        }
+    };
+
+    vec3 position(const VertexStreams& streams, uint32_t v)
+    {
+        return vec3(streams.x[v], streams.y[v], streams.z[v]);
+    }
+
+    // Where the cache simulation misses all 3 vertices of a triangle, the order has jumped to an unrelated part
+    // of the mesh, so a new cluster starts there. Returns the first triangle of each cluster.
+    std::vector<size_t> hard_boundaries(const std::vector<uint32_t>& indices, size_t vertex_count, int cache_size)
+    {
+        std::vector<size_t> boundaries;
+        VertexCacheSimulator cache(vertex_count, cache_size);
+        for (size_t t = 0; t < indices.size() / 3; t++)
+        {
+            if (cache.add_triangle(&indices[t * 3]) == 3 || t == 0) boundaries.push_back(t);
+        }
+        return boundaries;
+    }
+
+    // Splits the clusters further, wherever doing so keeps both halves about as cache friendly as the whole.
+    std::vector<size_t> soft_boundaries(const std::vector<uint32_t>& indices, size_t vertex_count, int cache_size,
+                                        const std::vector<size_t>& hard)
+    {
+        std::vector<size_t> boundaries;
+        VertexCacheSimulator cache(vertex_count, cache_size);
+        size_t triangle_count = indices.size() / 3;
+
+        for (size_t c = 0; c < hard.size(); c++)
+        {
+            size_t start = hard[c];
+            size_t end = (c + 1 < hard.size()) ? hard[c + 1] : triangle_count;
+
+            cache.flush();
+            int cluster_misses = 0;
+            for (size_t t = start; t < end; t++) cluster_misses += cache.add_triangle(&indices[t * 3]);
+            float threshold = SOFT_BOUNDARY_THRESHOLD * (float) cluster_misses / (float) (end - start);
+
+            cache.flush();
+            boundaries.push_back(start);
+            size_t sub_start = start;
+            int misses = 0;
+            for (size_t t = start; t + 1 < end; t++)
+            {
+                misses += cache.add_triangle(&indices[t * 3]);
+                if ((float) misses <= threshold * (float) (t + 1 - sub_start))
+                {
+                    boundaries.push_back(t + 1);
+                    sub_start = t + 1;
+                    misses = 0;
+                    cache.flush();
+                }
+            }
+        }
+        return boundaries;
+    }
+
+    // How many of the triangle's vertices aren't in the meshlet yet, given where each vertex is in its list.
+    int added_vertices(const uint32_t* corners, const std::vector<uint32_t>& vertex_slot)
+    {
+        return (vertex_slot[corners[0]] == NO_INDEX) + (vertex_slot[corners[1]] == NO_INDEX && corners[1] != corners[0])
+             + (vertex_slot[corners[2]] == NO_INDEX && corners[2] != corners[0] && corners[2] != corners[1]);
+    }
+
+    vec3 triangle_normal(const VertexStreams& streams, const uint32_t* triangle)
+    {
+        vec3 p0 = position(streams, triangle[0]);
+        return cross(position(streams, triangle[1]) - p0, position(streams, triangle[2]) - p0);
+    }
+
+    // Fills in the meshlet's bounding sphere and normal cone. Degenerate triangles face nowhere and are left out of the cone.
+    void compute_meshlet_bounds(Meshlet& meshlet, const std::vector<uint32_t>& indices, const uint32_t* vertices, const VertexStreams& streams)
+    {
+        vec3 bounds_min = position(streams, vertices[0]);
+        vec3 bounds_max = bounds_min;
+        for (uint32_t i = 1; i < meshlet.vertex_count; i++)
+        {
+            vec3 p = position(streams, vertices[i]);
+            for (int k = 0; k < 3; k++)
+            {
+                bounds_min[k] = std::min(bounds_min[k], p[k]);
+                bounds_max[k] = std::max(bounds_max[k], p[k]);
+            }
+        }
+        meshlet.center = (bounds_min + bounds_max) * 0.5f;
+        meshlet.radius = 0;
+        for (uint32_t i = 0; i < meshlet.vertex_count; i++)
+        {
+            meshlet.radius = std::max(meshlet.radius, (position(streams, vertices[i]) - meshlet.center).length());
+        }
+
+        const uint32_t* triangles = &indices[meshlet.triangle_offset * 3];
+        vec3 normal_sum(0, 0, 0);
+        for (uint32_t t = 0; t < meshlet.triangle_count; t++)
+        {
+            vec3 n = triangle_normal(streams, &triangles[t * 3]);
+            float length = n.length();
+            if (length > 0) normal_sum += n / length;
+        }
+
+        // Until shown otherwise, the cone is too wide to cull with.
+        meshlet.cone_apex = meshlet.center;
+        meshlet.cone_axis = vec3(0, 0, 1);
+        meshlet.cone_cutoff = 2;
+        float axis_length = normal_sum.length();
+        if (axis_length == 0) return;
+        vec3 axis = normal_sum / axis_length;
+
+        // The cone's apex is moved back along the axis until it lies behind the planes of all triangles.
+        // Then any eye that sees the apex from behind every triangle's normal sees each triangle from behind too.
+        float min_cosine = 1;
+        float apex_distance = 0;
+        for (uint32_t t = 0; t < meshlet.triangle_count; t++)
+        {
+            vec3 n = triangle_normal(streams, &triangles[t * 3]);
+            float length = n.length();
+            if (length == 0) continue;
+            n /= length;
+
+            float cosine = dot(n, axis);
+            min_cosine = std::min(min_cosine, cosine);
+            if (cosine <= MESHLET_MIN_CONE_COSINE) return;
+            apex_distance = std::max(apex_distance, dot(meshlet.center - position(streams, triangles[t * 3]), n) / cosine);
+        }
+
+        min_cosine -= MESHLET_CONE_MARGIN;
+        meshlet.cone_apex = meshlet.center - (axis * apex_distance);
+        meshlet.cone_axis = axis;
+        meshlet.cone_cutoff = std::sqrt(1 - (min_cosine * min_cosine));
+    }
+
+    // One axis-aligned orthographic view: the screen axes and the axis the viewer looks down, all as
+    // position components. The screen axes are picked so that counter-clockwise triangles face the viewer.
+    struct OverdrawView
+    {
+        int u, v;
+        int axis;
+        float toward_viewer; // 1 if the viewer is on the positive side of the axis.
+    };
+
+    const OverdrawView OVERDRAW_VIEWS[] = {
+        { 0, 1, 2, 1 }, { 1, 0, 2, -1 },
+        { 1, 2, 0, 1 }, { 2, 1, 0, -1 },
+        { 2, 0, 1, 1 }, { 0, 2, 1, -1 }
+    };
+}
+
+std::vector<uint32_t> weld_positions(ArrayView<uint32_t> indices, const VertexStreams& streams, uint32_t& position_count)
+{
+    std::unordered_map<PositionKey, uint32_t, PositionKeyHash> numbers;
+    std::vector<uint32_t> number(streams.size(), NO_INDEX);
+    position_count = 0;
+    for (uint32_t v : indices)
+    {
+        if (number[v] != NO_INDEX) continue;
+        PositionKey key;
+        const float values[3] = { streams.x[v], streams.y[v], streams.z[v] };
+        std::memcpy(key.bits, values, sizeof(values));
+        auto [it, inserted] = numbers.try_emplace(key, position_count);
+        if (inserted) position_count++;
+        number[v] = it->second;
+    }
+    return number;
+}
+
+void MeshOptimizationStats::print() const
+{
+    std::cout << "ACMR " << acmr_before << " -> " << acmr_after
+              << ", overdraw " << overdraw_before << " -> " << overdraw_after << std::endl;
+}
+
+std::vector<uint32_t> optimize_vertex_cache(ArrayView<uint32_t> indices, size_t vertex_count, int cache_size)
+{
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    if (indices.empty()) return result;
+
+    VertexTriangles adjacency(indices, vertex_count);
+    std::vector<uint32_t> live_triangles(vertex_count);
+    for (size_t v = 0; v < vertex_count; v++) live_triangles[v] = adjacency.offsets[v + 1] - adjacency.offsets[v];
+
+    std::vector<size_t> cache_time(vertex_count, 0);
+    std::vector<bool> emitted(indices.size() / 3, false);
+    std::vector<uint32_t> dead_ends;
+    std::vector<uint32_t> candidates;
+    size_t time = cache_size + 1;
+    size_t cursor = 0;
+
+    // Start from the first vertex that is used at all.
+    int64_t fan_vertex = indices[0];
+    while (fan_vertex >= 0)
+    {
+        candidates.clear();
+        for (uint32_t i = adjacency.offsets[fan_vertex]; i < adjacency.offsets[fan_vertex + 1]; i++)
+        {
+            uint32_t t = adjacency.triangles[i];
+            if (emitted[t]) continue;
+
+            for (int k = 0; k < 3; k++)
+            {
+                uint32_t v = indices[(t * 3) + k];
+                result.push_back(v);
+                dead_ends.push_back(v);
+                candidates.push_back(v);
+                live_triangles[v]--;
+                if (time - cache_time[v] > (size_t) cache_size)
+                {
+                    cache_time[v] = time++;
+                }
+            }
+            emitted[t] = true;
+        }
+
+        // Fan around the candidate that has been in the cache longest, but will still be there after its own fan is emitted.
+        // Candidates that would fall out of the cache get the lowest priority instead.
+        fan_vertex = -1;
+        int64_t best_priority = -1;
+        for (uint32_t v : candidates)
+        {
+            if (live_triangles[v] == 0) continue;
+
+            int64_t priority = 0;
+            if ((int64_t) (time - cache_time[v]) + (2 * (int64_t) live_triangles[v]) <= cache_size)
+            {
+                priority = (int64_t) (time - cache_time[v]);
+            }
+            if (priority > best_priority)
+            {
+                best_priority = priority;
+                fan_vertex = v;
+            }
+        }
+
+        // A dead end: go back to the most recent vertex that still has triangles left, or else to the next one in order.
+        while (fan_vertex < 0 && !dead_ends.empty())
+        {
+            uint32_t v = dead_ends.back();
+            dead_ends.pop_back();
+            if (live_triangles[v] > 0) fan_vertex = v;
+        }
+        for (; fan_vertex < 0 && cursor < vertex_count; cursor++)
+        {
+            if (live_triangles[cursor] > 0) fan_vertex = (int64_t) cursor;
+        }
+    }
+    return result;
+}
+
+void optimize_overdraw(std::vector<uint32_t>& indices, const VertexStreams& streams, int cache_size)
+{
+    size_t triangle_count = indices.size() / 3;
+    if (triangle_count == 0) return;
+
+    std::vector<size_t> hard = hard_boundaries(indices, streams.size(), cache_size);
+    std::vector<size_t> clusters = soft_boundaries(indices, streams.size(), cache_size, hard);
+    size_t cluster_count = clusters.size();
+    clusters.push_back(triangle_count);
+
+    // Area-weighted centroid and normal of each cluster.
+    std::vector<vec3> centroids(cluster_count);
+    std::vector<vec3> normals(cluster_count);
+    vec3 mesh_centroid(0, 0, 0);
+    float mesh_area = 0;
+    for (size_t c = 0; c < cluster_count; c++)
+    {
+        vec3 centroid(0, 0, 0);
+        vec3 normal(0, 0, 0);
+        float area = 0;
+        for (size_t t = clusters[c]; t < clusters[c + 1]; t++)
+        {
+            vec3 p0 = position(streams, indices[t * 3]);
+            vec3 p1 = position(streams, indices[(t * 3) + 1]);
+            vec3 p2 = position(streams, indices[(t * 3) + 2]);
+            vec3 n = cross(p1 - p0, p2 - p0);
+            float a = n.length();
+            centroid += (p0 + p1 + p2) * (a / 3);
+            normal += n;
+            area += a;
+        }
+
+        mesh_centroid += centroid;
+        mesh_area += area;
+        centroids[c] = (area > 0) ? centroid / area : position(streams, indices[clusters[c] * 3]);
+        float length = normal.length();
+        normals[c] = (length > 0) ? normal / length : vec3(0, 0, 0);
+    }
+    if (mesh_area > 0) mesh_centroid /= mesh_area;
+
+    std::vector<float> scores(cluster_count);
+    for (size_t c = 0; c < cluster_count; c++)
+    {
+        scores[c] = dot(centroids[c] - mesh_centroid, normals[c]);
+    }
+
+    std::vector<uint32_t> order(cluster_count);
+    for (size_t c = 0; c < cluster_count; c++) order[c] = (uint32_t) c;
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return scores[a] > scores[b]; });
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (uint32_t c : order)
+    {
+        result.insert(result.end(), indices.begin() + (clusters[c] * 3), indices.begin() + (clusters[c + 1] * 3));
+    }
+    indices = std::move(result);
+}
+
+std::vector<Meshlet> build_meshlets(std::vector<uint32_t>& indices, const VertexStreams& streams, std::vector<uint32_t>& meshlet_vertices, int cache_size)
+{
+    std::vector<Meshlet> meshlets;
+    meshlet_vertices.clear();
+    size_t triangle_count = indices.size() / 3;
+    size_t vertex_count = streams.size();
+    if (triangle_count == 0) return meshlets;
+
+    // Triangles are neighbours when they share a position, even if not a vertex, as at the hard edges of flat shading.
+    uint32_t position_count;
+    std::vector<uint32_t> position_of = weld_positions(ArrayView<uint32_t>(indices.data(), indices.size()), streams, position_count);
+    std::vector<uint32_t> welded(indices.size());
+    for (size_t i = 0; i < indices.size(); i++) welded[i] = position_of[indices[i]];
+    VertexTriangles adjacency(ArrayView<uint32_t>(welded.data(), welded.size()), position_count);
+
+    std::vector<vec3> normals(triangle_count);
+    std::vector<vec3> centroids(triangle_count);
+    float total_area = 0;
+    for (size_t t = 0; t < triangle_count; t++)
+    {
+        vec3 n = triangle_normal(streams, &indices[t * 3]);
+        float length = n.length();
+        normals[t] = (length > 0) ? n / length : vec3(0, 0, 0);
+        centroids[t] = (position(streams, indices[t * 3]) + position(streams, indices[(t * 3) + 1]) + position(streams, indices[(t * 3) + 2])) / 3;
+        total_area += length * 0.5f;
+    }
+    // About how far a full meshlet of average triangles reaches from its centre.
+    float expected_radius = std::sqrt((total_area / (float) triangle_count) * Meshlet::MAX_TRIANGLES) * 0.5f;
+    float distance_scale = (expected_radius > 0) ? MESHLET_DISTANCE_WEIGHT / expected_radius : 0;
+
+    std::vector<bool> emitted(triangle_count, false);
+    std::vector<uint32_t> vertex_slot(vertex_count, NO_INDEX); // Where each vertex is in the current meshlet's list.
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    std::vector<uint32_t> meshlet_triangles;
+    std::vector<uint32_t> local_indices;
+    std::vector<uint32_t> vertices;
+    size_t seed = 0;
+
+    while (true)
+    {
+        while (seed < triangle_count && emitted[seed]) seed++;
+        if (seed == triangle_count) break;
+
+        meshlet_triangles.clear();
+        vertices.clear();
+        vec3 normal_sum(0, 0, 0);
+        vec3 centroid_sum(0, 0, 0);
+
+        uint32_t next = (uint32_t) seed;
+        while (next != NO_INDEX)
+        {
+            emitted[next] = true;
+            meshlet_triangles.push_back(next);
+            for (int k = 0; k < 3; k++)
+            {
+                uint32_t v = indices[(next * 3) + k];
+                if (vertex_slot[v] != NO_INDEX) continue;
+                vertex_slot[v] = (uint32_t) vertices.size();
+                vertices.push_back(v);
+            }
+            normal_sum += normals[next];
+            centroid_sum += centroids[next];
+            if (meshlet_triangles.size() == Meshlet::MAX_TRIANGLES) break;
+
+            float axis_length = normal_sum.length();
+            vec3 axis = (axis_length > 0) ? normal_sum / axis_length : vec3(0, 0, 0);
+            vec3 centroid = centroid_sum / (float) meshlet_triangles.size();
+
+            // The best triangle next to the meshlet that still fits.
+            bool small = meshlet_triangles.size() < MESHLET_SMALL_TRIANGLES;
+            next = NO_INDEX;
+            float best_score = std::numeric_limits<float>::max();
+            for (uint32_t v : vertices)
+            {
+                uint32_t p = position_of[v];
+                for (uint32_t i = adjacency.offsets[p]; i < adjacency.offsets[p + 1]; i++)
+                {
+                    uint32_t t = adjacency.triangles[i];
+                    if (emitted[t]) continue;
+
+                    int added = added_vertices(&indices[t * 3], vertex_slot);
+                    if (vertices.size() + added > Meshlet::MAX_VERTICES) continue;
+
+                    // Degenerate triangles face nowhere, so they fit into any meshlet.
+                    float cosine = dot(normals[t], axis);
+                    bool degenerate = normals[t].x == 0 && normals[t].y == 0 && normals[t].z == 0;
+                    if (axis_length > 0 && !degenerate && cosine < MESHLET_MIN_JOIN_COSINE && !small) continue;
+
+                    float score = (float) added + (MESHLET_CONE_WEIGHT * (1 - cosine))
+                                + ((centroids[t] - centroid).length() * distance_scale);
+                    if (score < best_score)
+                    {
+                        best_score = score;
+                        next = t;
+                    }
+                }
+            }
+
+            // Without a neighbour that fits, a small meshlet goes on with the next triangle in order, which the earlier
+            // passes mostly put close by. A large one is done.
+            if (next == NO_INDEX && small)
+            {
+                while (seed < triangle_count && emitted[seed]) seed++;
+                if (seed < triangle_count && vertices.size() + added_vertices(&indices[seed * 3], vertex_slot) <= Meshlet::MAX_VERTICES)
+                {
+                    next = (uint32_t) seed;
+                }
+            }
+        }
+
+        Meshlet meshlet;
+        meshlet.triangle_offset = (uint32_t) (result.size() / 3);
+        meshlet.triangle_count = (uint32_t) meshlet_triangles.size();
+        meshlet.vertex_offset = (uint32_t) meshlet_vertices.size();
+        meshlet.vertex_count = (uint32_t) vertices.size();
+        meshlets.push_back(meshlet);
+
+        // Grouping the triangles undoes the order the vertex cache pass gave them, so it is run again on each meshlet,
+        // with the meshlet's own vertex numbers to keep it small.
+        local_indices.clear();
+        for (uint32_t t : meshlet_triangles)
+        {
+            for (int k = 0; k < 3; k++) local_indices.push_back(vertex_slot[indices[(t * 3) + k]]);
+        }
+        for (uint32_t v : optimize_vertex_cache(ArrayView<uint32_t>(local_indices.data(), local_indices.size()), vertices.size(), cache_size))
+        {
+            result.push_back(vertices[v]);
+        }
+        for (uint32_t v : vertices) vertex_slot[v] = NO_INDEX;
+        meshlet_vertices.insert(meshlet_vertices.end(), vertices.begin(), vertices.end());
+    }
+    indices = std::move(result);
+
+    for (Meshlet& meshlet : meshlets)
+    {
+        compute_meshlet_bounds(meshlet, indices, &meshlet_vertices[meshlet.vertex_offset], streams);
+    }
+    return meshlets;
+}
+
+std::vector<Meshlet> split_meshlets(const std::vector<uint32_t>& indices, const VertexStreams& streams, std::vector<uint32_t>& meshlet_vertices)
+{
+    std::vector<Meshlet> meshlets;
+    meshlet_vertices.clear();
+    size_t triangle_count = indices.size() / 3;
+    std::vector<uint32_t> vertex_slot(streams.size(), NO_INDEX);
+    std::vector<uint32_t> vertices;
+    size_t begin = 0;
+
+    for (size_t t = 0; t <= triangle_count; t++)
+    {
+        bool fits = t < triangle_count && t - begin < Meshlet::MAX_TRIANGLES;
+        if (fits)
+        {
+            fits = vertices.size() + added_vertices(&indices[t * 3], vertex_slot) <= Meshlet::MAX_VERTICES;
+        }
+
+        if (!fits && t > begin)
+        {
+            Meshlet meshlet;
+            meshlet.triangle_offset = (uint32_t) begin;
+            meshlet.triangle_count = (uint32_t) (t - begin);
+            meshlet.vertex_offset = (uint32_t) meshlet_vertices.size();
+            meshlet.vertex_count = (uint32_t) vertices.size();
+            meshlets.push_back(meshlet);
+            for (uint32_t v : vertices) vertex_slot[v] = NO_INDEX;
+            meshlet_vertices.insert(meshlet_vertices.end(), vertices.begin(), vertices.end());
+            vertices.clear();
+            begin = t;
+        }
+        if (t == triangle_count) break;
+
+        for (int k = 0; k < 3; k++)
+        {
+            uint32_t v = indices[(t * 3) + k];
+            if (vertex_slot[v] != NO_INDEX) continue;
+            vertex_slot[v] = (uint32_t) vertices.size();
+            vertices.push_back(v);
+        }
+    }
+
+    for (Meshlet& meshlet : meshlets)
+    {
+        compute_meshlet_bounds(meshlet, indices, &meshlet_vertices[meshlet.vertex_offset], streams);
+    }
+    return meshlets;
+}
+
+std::vector<uint32_t> optimize_vertex_fetch(std::vector<uint32_t>& indices, size_t vertex_count)
+{
+    constexpr uint32_t UNUSED = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> new_index(vertex_count, UNUSED);
+    std::vector<uint32_t> old_index;
+
+    for (uint32_t& v : indices)
+    {
+        if (new_index[v] == UNUSED)
+        {
+            new_index[v] = (uint32_t) old_index.size();
+            old_index.push_back(v);
+        }
+        v = new_index[v];
+    }
+    return old_index;
+}
+
+float analyze_acmr(ArrayView<uint32_t> indices, size_t vertex_count, int cache_size)
+{
+    if (indices.empty()) return 0;
+
+    VertexCacheSimulator cache(vertex_count, cache_size);
+    size_t misses = 0;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+        misses += cache.add_triangle(&indices[i]);
+    }
+    return (float) misses / (float) (indices.size() / 3);
+}
+
+float analyze_overdraw(ArrayView<uint32_t> indices, const VertexStreams& streams)
+{
+    if (indices.empty()) return 0;
+
+    // The mesh is scaled uniformly to fit the viewport from every side.
+    vec3 bounds_min = position(streams, indices[0]);
+    vec3 bounds_max = bounds_min;
+    for (uint32_t v : indices)
+    {
+        vec3 p = position(streams, v);
+        for (int k = 0; k < 3; k++)
+        {
+            bounds_min[k] = std::min(bounds_min[k], p[k]);
+            bounds_max[k] = std::max(bounds_max[k], p[k]);
+        }
+    }
+    float extent = std::max({ bounds_max.x - bounds_min.x, bounds_max.y - bounds_min.y, bounds_max.z - bounds_min.z });
+    float scale = (extent > 0) ? (float) OVERDRAW_VIEWPORT / extent : 0;
+
+    std::vector<float> depth_buffer(OVERDRAW_VIEWPORT * OVERDRAW_VIEWPORT);
+    uint64_t covered = 0;
+    uint64_t shaded = 0;
+
+    for (const OverdrawView& view : OVERDRAW_VIEWS)
+    {
+        std::fill(depth_buffer.begin(), depth_buffer.end(), std::numeric_limits<float>::max());
+
+        for (size_t i = 0; i + 2 < indices.size(); i += 3)
+        {
+            // Screen position and depth (smaller is closer) of each corner.
+            float sx[3], sy[3], sz[3];
+            for (int k = 0; k < 3; k++)
+            {
+                vec3 p = position(streams, indices[i + k]);
+                sx[k] = (p[view.u] - bounds_min[view.u]) * scale;
+                sy[k] = (p[view.v] - bounds_min[view.v]) * scale;
+                sz[k] = -view.toward_viewer * p[view.axis];
+            }
+
+            float area = ((sx[1] - sx[0]) * (sy[2] - sy[0])) - ((sx[2] - sx[0]) * (sy[1] - sy[0]));
+            if (area <= 0) continue;
+
+            int min_x = std::max(0, (int) std::min({ sx[0], sx[1], sx[2] }));
+            int min_y = std::max(0, (int) std::min({ sy[0], sy[1], sy[2] }));
+            int max_x = std::min(OVERDRAW_VIEWPORT - 1, (int) std::max({ sx[0], sx[1], sx[2] }));
+            int max_y = std::min(OVERDRAW_VIEWPORT - 1, (int) std::max({ sy[0], sy[1], sy[2] }));
+
+            for (int y = min_y; y <= max_y; y++)
+            {
+                for (int x = min_x; x <= max_x; x++)
+                {
+                    float px = (float) x + 0.5f;
+                    float py = (float) y + 0.5f;
+                    float w0 = ((sx[2] - sx[1]) * (py - sy[1])) - ((sy[2] - sy[1]) * (px - sx[1]));
+                    float w1 = ((sx[0] - sx[2]) * (py - sy[2])) - ((sy[0] - sy[2]) * (px - sx[2]));
+                    float w2 = ((sx[1] - sx[0]) * (py - sy[0])) - ((sy[1] - sy[0]) * (px - sx[0]));
+                    if (w0 < 0 || w1 < 0 || w2 < 0) continue;
+
+                    float z = ((w0 * sz[0]) + (w1 * sz[1]) + (w2 * sz[2])) / area;
+                    float& depth = depth_buffer[(y * OVERDRAW_VIEWPORT) + x];
+                    if (z >= depth) continue;
+
+                    if (depth == std::numeric_limits<float>::max()) covered++;
+                    depth = z;
+                    shaded++;
+                }
+            }
+        }
+    }
+    return covered ? (float) shaded / (float) covered : 0;
+}
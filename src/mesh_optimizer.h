@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "mesh.h"
+
+// Reorders indexed triangle lists so that they render faster, without changing what they look like:
+// first the triangles, for reuse of transformed vertices, then clusters of them, for less overdraw,
+// and finally the vertices themselves, so that they are fetched in the order they are used.
+
+// What Mesh::optimize achieved.
+struct MeshOptimizationStats
+{
+    float acmr_before = 0;
+    float acmr_after = 0;
+    float overdraw_before = 0;
+    float overdraw_after = 0;
+
+    void print() const;
+};
+
+// Triangle order for a post-transform vertex cache of the given size, with Tipsify
+// (Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw", 2007):
+// triangles are emitted in fans around a vertex, and the next fan is around the neighbour that is freshest in the cache.
+std::vector<uint32_t> optimize_vertex_cache(ArrayView<uint32_t> indices, size_t vertex_count, int cache_size);
+
+// Splits the triangles into clusters where the vertex cache starts over, and reorders the clusters so that those
+// most likely to hide others from any direction (furthest out along their own normal) are drawn first.
+// Clusters are only split where it costs at most a few percent of ACMR, and each keeps its triangle order.
+void optimize_overdraw(std::vector<uint32_t>& indices, const VertexStreams& streams, int cache_size);
+
+// Splits the triangles into meshlets of at most Meshlet::MAX_VERTICES vertices and Meshlet::MAX_TRIANGLES triangles,
+// and reorders them so that each meshlet's triangles are consecutive. Meshlets are grown from the first triangle
+// not yet taken, in the current order, over neighbouring triangles (those sharing a position) that face the same way
+// and add the fewest vertices, so that they are tight enough to cull by their normal cones. Small meshlets take
+// neighbours facing other ways too, or else the next triangle in order, rather than end up costing more to cull than
+// they save. Within a meshlet, the triangles are put in vertex cache
+// order for a cache of the given size. The distinct vertices of each meshlet are written to meshlet_vertices.
+std::vector<Meshlet> build_meshlets(std::vector<uint32_t>& indices, const VertexStreams& streams, std::vector<uint32_t>& meshlet_vertices,
+                                    int cache_size);
+
+// Cuts the triangles into meshlets as they come, each as many consecutive triangles as fit, so that their order stays
+// exactly as it is. The meshlets are looser than build_meshlets', and cull less.
+std::vector<Meshlet> split_meshlets(const std::vector<uint32_t>& indices, const VertexStreams& streams, std::vector<uint32_t>& meshlet_vertices);
+
+// Renumbers the vertices in the order the triangles first use them, and returns the old number of each new vertex.
+// Vertices no triangle uses are dropped.
+std::vector<uint32_t> optimize_vertex_fetch(std::vector<uint32_t>& indices, size_t vertex_count);
+
+// Numbers the distinct positions the triangles use, in the order they first come up. Vertices with bitwise equal
+// positions, which only differ in their normals or uvs, get the same number, so that triangles that share no vertex
+// are still found to touch. Returns the number of every vertex, or UINT32_MAX for those no triangle uses.
+std::vector<uint32_t> weld_positions(ArrayView<uint32_t> indices, const VertexStreams& streams, uint32_t& position_count);
+
+// Vertex shader runs per triangle when the post-transform results are kept in a FIFO cache of the given size.
+float analyze_acmr(ArrayView<uint32_t> indices, size_t vertex_count, int cache_size);
+
+// Fragments shaded per covered pixel, with back-face culling and the depth test before shading,
+// averaged over orthographic views of the mesh from its 6 sides. 1 means no overdraw at all.
+float analyze_overdraw(ArrayView<uint32_t> indices, const VertexStreams& streams);
@@ -0,0 +1,426 @@
+#include "mesh_simplifier.h"
+#include "mesh_optimizer.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <unordered_map>
+
+namespace
+{
+    // A level is only kept if it has at most this fraction of the triangles of the one before. Otherwise so few
+    // collapses were left that it would look the same and cost about the same to draw.
+    constexpr float MIN_LEVEL_REDUCTION = 0.75f;
+
+    constexpr uint32_t NO_VERTEX = std::numeric_limits<uint32_t>::max();
+
+    // The sum of the squared distances to a set of planes, each weighted by the area of the triangle it came from,
+    // kept as the symmetric 4x4 matrix of the quadratic form, along with the total weight.
+    struct Quadric
+    {
+        double xx = 0, xy = 0, xz = 0, xw = 0;
+        double yy = 0, yz = 0, yw = 0;
+        double zz = 0, zw = 0;
+        double ww = 0;
+        double weight = 0;
+
+        // The plane dot(normal, p) + d = 0, where normal has unit length.
+        void add_plane(const vec3& normal, double d, double w)
+        {
+            double a = normal.x, b = normal.y, c = normal.z;
+            xx += w * a * a; xy += w * a * b; xz += w * a * c; xw += w * a * d;
+            yy += w * b * b; yz += w * b * c; yw += w * b * d;
+            zz += w * c * c; zw += w * c * d;
+            ww += w * d * d;
+            weight += w;
+        }
+
+        Quadric& operator+=(const Quadric& other)
+        {
+            xx += other.xx; xy += other.xy; xz += other.xz; xw += other.xw;
+            yy += other.yy; yz += other.yz; yw += other.yw;
+            zz += other.zz; zw += other.zw;
+            ww += other.ww;
+            weight += other.weight;
+            return *this;
+        }
+
+        // The weighted mean of the squared distances from p to the planes.
+        double mean_error(const vec3& p) const
+        {
+            if (weight <= 0) return 0;
+            double x = p.x, y = p.y, z = p.z;
+            double e = (xx * x * x) + (yy * y * y) + (zz * z * z) + ww
+                     + 2 * ((xy * x * y) + (xz * x * z) + (yz * y * z) + (xw * x) + (yw * y) + (zw * z));
+            return std::max(e, 0.0) / weight;
+        }
+    };
+
+    // Moving every vertex at one position onto vertices at a neighbouring position. Positions are numbered
+    // as Simplifier groups them, and each carries a version that changes whenever its quadric does, so that
+    // queued collapses that were costed before that can be recognized as stale.
+    struct Collapse
+    {
+        float error;
+        uint32_t from;
+        uint32_t to;
+        uint32_t from_version;
+        uint32_t to_version;
+
+        bool operator>(const Collapse& other) const { return error > other.error; }
+    };
+
+    // The state of one run of edge collapses. The surface is handled per position (a group of vertices that only
+    // differ in their normals or uvs), so that collapses move all of them together and never open a crack.
+    class Simplifier
+    {
+        public:
+            Simplifier(ArrayView<uint32_t> indices, const VertexStreams& streams) :
+                streams(streams), corners(indices.begin(), indices.end()), alive(indices.size() / 3, 1)
+            {
+                group_positions();
+                find_borders();
+                add_quadrics();
+
+                for (uint32_t g = 0; g < group_count(); g++)
+                {
+                    if (locked[g]) continue;
+                    neighbours(g, neighbours_a);
+                    for (uint32_t n : neighbours_a) push_collapse(g, n);
+                }
+            }
+
+            // Collapses edges, cheapest first, until at most target triangles are left or no edge can go.
+            void collapse_until(size_t target)
+            {
+                while (live_triangles > target && !queue.empty())
+                {
+                    Collapse collapse = queue.top();
+                    queue.pop();
+                    if (removed[collapse.from] || removed[collapse.to]) continue;
+                    if (version[collapse.from] != collapse.from_version || version[collapse.to] != collapse.to_version) continue;
+
+                    if (try_collapse(collapse.from, collapse.to))
+                    {
+                        max_error = std::max(max_error, collapse.error);
+                    }
+                }
+            }
+
+            size_t triangle_count() const
+            {
+                return live_triangles;
+            }
+
+            float error() const
+            {
+                return max_error;
+            }
+
+            std::vector<uint32_t> indices() const
+            {
+                std::vector<uint32_t> result;
+                result.reserve(live_triangles * 3);
+                for (size_t t = 0; t < alive.size(); t++)
+                {
+                    if (!alive[t]) continue;
+                    result.insert(result.end(), corners.begin() + (t * 3), corners.begin() + (t * 3) + 3);
+                }
+                return result;
+            }
+
+        private:
+            uint32_t group_count() const
+            {
+                return (uint32_t) positions.size();
+            }
+
+            vec3 position(uint32_t v) const
+            {
+                return vec3(streams.x[v], streams.y[v], streams.z[v]);
+            }
+
+            bool same_uv(uint32_t a, uint32_t b) const
+            {
+                return streams.u[a] == streams.u[b] && streams.v[a] == streams.v[b];
+            }
+
+            float normal_dot(uint32_t a, uint32_t b) const
+            {
+                return (streams.nx[a] * streams.nx[b]) + (streams.ny[a] * streams.ny[b]) + (streams.nz[a] * streams.nz[b]);
+            }
+
+            // Numbers the distinct positions, and lists for each the triangles that use it.
+            // Triangles with two corners at the same position cover nothing, and are dropped right away.
+            void group_positions()
+            {
+                uint32_t count;
+                group = weld_positions(ArrayView<uint32_t>(corners.data(), corners.size()), streams, count);
+                positions.reserve(count);
+                for (uint32_t v : corners)
+                {
+                    if (group[v] == group_count()) positions.push_back(position(v));
+                }
+
+                group_triangles.resize(group_count());
+                live_triangles = 0;
+                for (uint32_t t = 0; t < alive.size(); t++)
+                {
+                    uint32_t g0 = group[corners[t * 3]], g1 = group[corners[(t * 3) + 1]], g2 = group[corners[(t * 3) + 2]];
+                    if (g0 == g1 || g1 == g2 || g2 == g0)
+                    {
+                        alive[t] = 0;
+                        continue;
+                    }
+                    group_triangles[g0].push_back(t);
+                    group_triangles[g1].push_back(t);
+                    group_triangles[g2].push_back(t);
+                    live_triangles++;
+                }
+                removed.assign(group_count(), 0);
+                version.assign(group_count(), 0);
+            }
+
+            // Locks the positions on edges that don't have exactly two triangles: the open borders of the mesh,
+            // which would pull away from whatever they meet if they moved, and non-manifold edges.
+            void find_borders()
+            {
+                std::unordered_map<uint64_t, uint32_t> edge_triangles;
+                for (size_t t = 0; t < alive.size(); t++)
+                {
+                    if (!alive[t]) continue;
+                    for (int k = 0; k < 3; k++)
+                    {
+                        uint64_t a = group[corners[(t * 3) + k]], b = group[corners[(t * 3) + ((k + 1) % 3)]];
+                        edge_triangles[(std::min(a, b) << 32) | std::max(a, b)]++;
+                    }
+                }
+
+                locked.assign(group_count(), 0);
+                for (const auto& [edge, count] : edge_triangles)
+                {
+                    if (count == 2) continue;
+                    locked[edge >> 32] = 1;
+                    locked[edge & 0xFFFFFFFF] = 1;
+                }
+            }
+
+            void add_quadrics()
+            {
+                quadrics.assign(group_count(), Quadric());
+                for (size_t t = 0; t < alive.size(); t++)
+                {
+                    if (!alive[t]) continue;
+                    uint32_t g[3] = { group[corners[t * 3]], group[corners[(t * 3) + 1]], group[corners[(t * 3) + 2]] };
+                    vec3 normal = cross(positions[g[1]] - positions[g[0]], positions[g[2]] - positions[g[0]]);
+                    float length = normal.length();
+                    if (!(length > 0)) continue;
+
+                    normal /= length;
+                    double d = -dot(normal, positions[g[0]]);
+                    for (int k = 0; k < 3; k++)
+                    {
+                        quadrics[g[k]].add_plane(normal, d, 0.5 * length);
+                    }
+                }
+            }
+
+            // The positions that share a live triangle with g, in increasing order. Drops g's dead triangles on the way.
+            void neighbours(uint32_t g, std::vector<uint32_t>& result)
+            {
+                std::vector<uint32_t>& around = group_triangles[g];
+                around.erase(std::remove_if(around.begin(), around.end(), [this](uint32_t t) { return !alive[t]; }), around.end());
+
+                result.clear();
+                for (uint32_t t : around)
+                {
+                    for (int k = 0; k < 3; k++)
+                    {
+                        uint32_t n = group[corners[(t * 3) + k]];
+                        if (n != g) result.push_back(n);
+                    }
+                }
+                std::sort(result.begin(), result.end());
+                result.erase(std::unique(result.begin(), result.end()), result.end());
+            }
+
+            void push_collapse(uint32_t from, uint32_t to)
+            {
+                Quadric merged = quadrics[from];
+                merged += quadrics[to];
+                float error = (float) std::sqrt(merged.mean_error(positions[to]));
+                queue.push({ error, from, to, version[from], version[to] });
+            }
+
+            // Moves every vertex at position a onto a vertex at position b, if that keeps the mesh intact.
+            bool try_collapse(uint32_t a, uint32_t b)
+            {
+                // Topology: a and b must not share more than the two neighbours across their edge,
+                // or the collapse would fold the surface onto itself.
+                neighbours(a, neighbours_a);
+                neighbours(b, neighbours_b);
+                size_t shared = 0;
+                for (size_t i = 0, j = 0; i < neighbours_a.size() && j < neighbours_b.size();)
+                {
+                    if (neighbours_a[i] < neighbours_b[j]) i++;
+                    else if (neighbours_b[j] < neighbours_a[i]) j++;
+                    else { shared++; i++; j++; }
+                }
+                if (shared > 2) return false;
+
+                // Each vertex at a goes to the vertex at b that it shares a triangle with, if any. The others go to the
+                // vertex at b with the nearest normal among those on the same side of any uv seam, which is known from
+                // a vertex with the same uv that does share a triangle. A side of a seam without any such vertex would
+                // have its texture torn off, so the collapse is refused.
+                const std::vector<uint32_t>& around = group_triangles[a];
+                wedges.clear();
+                targets.clear();
+                for (uint32_t t : around)
+                {
+                    uint32_t from = NO_VERTEX, to = NO_VERTEX;
+                    for (int k = 0; k < 3; k++)
+                    {
+                        uint32_t v = corners[(t * 3) + k];
+                        if (group[v] == a) from = v;
+                        if (group[v] == b) to = v;
+                    }
+                    size_t w = std::find(wedges.begin(), wedges.end(), from) - wedges.begin();
+                    if (w == wedges.size())
+                    {
+                        wedges.push_back(from);
+                        targets.push_back(NO_VERTEX);
+                    }
+                    if (targets[w] == NO_VERTEX) targets[w] = to;
+                }
+
+                b_wedges.clear();
+                for (uint32_t t : group_triangles[b])
+                {
+                    for (int k = 0; k < 3; k++)
+                    {
+                        uint32_t v = corners[(t * 3) + k];
+                        if (group[v] == b && std::find(b_wedges.begin(), b_wedges.end(), v) == b_wedges.end()) b_wedges.push_back(v);
+                    }
+                }
+
+                for (size_t w = 0; w < wedges.size(); w++)
+                {
+                    if (targets[w] != NO_VERTEX) continue;
+
+                    uint32_t side = NO_VERTEX;
+                    for (size_t s = 0; s < wedges.size() && side == NO_VERTEX; s++)
+                    {
+                        if (targets[s] != NO_VERTEX && same_uv(wedges[s], wedges[w])) side = targets[s];
+                    }
+                    if (side == NO_VERTEX) return false;
+
+                    uint32_t best = side;
+                    for (uint32_t v : b_wedges)
+                    {
+                        if (same_uv(v, side) && normal_dot(v, wedges[w]) > normal_dot(best, wedges[w])) best = v;
+                    }
+                    targets[w] = best;
+                }
+
+                // Geometry: none of the triangles that stay may turn over.
+                const vec3& destination = positions[b];
+                for (uint32_t t : around)
+                {
+                    vec3 p[3];
+                    bool dies = false;
+                    int moved = 0;
+                    for (int k = 0; k < 3; k++)
+                    {
+                        uint32_t g = group[corners[(t * 3) + k]];
+                        dies = dies || g == b;
+                        if (g == a) moved = k;
+                        p[k] = positions[g];
+                    }
+                    if (dies) continue;
+
+                    vec3 before = cross(p[1] - p[0], p[2] - p[0]);
+                    p[moved] = destination;
+                    vec3 after = cross(p[1] - p[0], p[2] - p[0]);
+                    if (!(dot(before, after) > 0)) return false;
+                }
+
+                for (uint32_t t : around)
+                {
+                    bool dies = false;
+                    for (int k = 0; k < 3; k++)
+                    {
+                        uint32_t& v = corners[(t * 3) + k];
+                        if (group[v] == b) dies = true;
+                        if (group[v] == a) v = targets[std::find(wedges.begin(), wedges.end(), v) - wedges.begin()];
+                    }
+                    if (dies)
+                    {
+                        alive[t] = 0;
+                        live_triangles--;
+                    } else
+                    {
+                        group_triangles[b].push_back(t);
+                    }
+                }
+
+                group_triangles[a] = std::vector<uint32_t>();
+                removed[a] = 1;
+                quadrics[b] += quadrics[a];
+                version[b]++;
+
+                neighbours(b, neighbours_b);
+                for (uint32_t n : neighbours_b)
+                {
+                    if (!locked[b]) push_collapse(b, n);
+                    if (!locked[n]) push_collapse(n, b);
+                }
+                return true;
+            }
+
+            const VertexStreams& streams;
+            std::vector<uint32_t> corners; // The current triangles, 3 vertices each.
+            std::vector<uint8_t> alive;
+            size_t live_triangles = 0;
+            float max_error = 0;
+
+            // Per vertex, its position's number, and per position:
+            std::vector<uint32_t> group;
+            std::vector<vec3> positions;
+            std::vector<std::vector<uint32_t>> group_triangles; // May still hold triangles that have died since.
+            std::vector<Quadric> quadrics;
+            std::vector<uint8_t> locked;
+            std::vector<uint8_t> removed;
+            std::vector<uint32_t> version;
+
+            std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+
+            // Scratch space for try_collapse.
+            std::vector<uint32_t> neighbours_a;
+            std::vector<uint32_t> neighbours_b;
+            std::vector<uint32_t> wedges;   // The vertices at the position that moves,
+            std::vector<uint32_t> targets;  // and the vertex each one moves onto.
+            std::vector<uint32_t> b_wedges; // The vertices at the position they move to.
+    };
+}
+
+std::vector<SimplifiedLevel> simplify_lods(ArrayView<uint32_t> indices, const VertexStreams& streams, size_t max_levels, size_t min_triangles)
+{
+    std::vector<SimplifiedLevel> levels;
+    Simplifier simplifier(indices, streams);
+    size_t previous = simplifier.triangle_count();
+
+    while (levels.size() < max_levels)
+    {
+        size_t target = previous / 2;
+        if (target < min_triangles) break;
+
+        simplifier.collapse_until(target);
+        size_t count = simplifier.triangle_count();
+        if (count > previous * MIN_LEVEL_REDUCTION) break;
+
+        levels.push_back({ simplifier.indices(), simplifier.error() });
+        previous = count;
+    }
+    return levels;
+}
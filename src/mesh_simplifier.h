@@ -0,0 +1,24 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "mesh.h"
+
+// One simplified version of a mesh's triangles, from simplify_lods.
+struct SimplifiedLevel
+{
+    std::vector<uint32_t> indices; // Into the same vertices as the full mesh.
+    // How far the simplified surface is from the full mesh, in object space: the largest root mean square distance,
+    // from the new position of a merged vertex to the planes of the triangles it stands in for, of any collapse so far.
+    float error = 0;
+};
+
+// Builds a chain of ever simpler versions of the triangles by edge collapse with quadric error metrics
+// (Garland and Heckbert, "Surface Simplification Using Quadric Error Metrics", 1997): the edge whose collapse moves
+// the surface the least goes first. A vertex only ever collapses onto a neighbouring one, so every level uses a subset
+// of the mesh's own vertices and needs no vertices of its own.
+//
+// Vertices at the same position but with different normals or uvs are collapsed together. Uv seams are kept, and so
+// are the open borders of the mesh, so that levels never tear apart; collapses that would flip a triangle are skipped.
+// Each level has at most half the triangles of the one before. The chain ends after max_levels levels, before a level
+// would have fewer than min_triangles, or when nothing more can be collapsed.
+std::vector<SimplifiedLevel> simplify_lods(ArrayView<uint32_t> indices, const VertexStreams& streams, size_t max_levels, size_t min_triangles);
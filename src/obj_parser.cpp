@@ -0,0 +1,345 @@
+#include "obj_parser.h"
+#include "mapped_file.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+    // Splitting a file finer than this isn't worth the extra stitching.
+    constexpr size_t MIN_CHUNK_BYTES = 1 << 20;
+
+    bool is_space(char c)
+    {
+        return c == ' ' || c == '\t';
+    }
+
+    bool is_digit(char c)
+    {
+        return static_cast<unsigned int>(c - '0') < 10u;
+    }
+
+    // The records of the lines in [begin, end). Absolute indices in a face are already global,
+    // but relative (negative) ones are counted from this chunk's start until the counts of the chunks before it are known.
+    struct ObjChunk
+    {
+        const char* begin = nullptr;
+        const char* end = nullptr;
+
+        std::vector<float> positions;
+        std::vector<float> normals;
+        std::vector<float> texcoords;
+        std::vector<tinyobj::index_t> indices;
+
+        // For each corner in indices, which of its indices are relative: bit 0 for the vertex, 1 for the normal
+        // and 2 for the texcoord index.
+        std::vector<uint8_t> relative;
+        bool any_relative = false;
+    };
+
+    // A corner of a face, before triangulation.
+    struct ObjCorner
+    {
+        tinyobj::index_t index;
+        uint8_t relative_mask; // As in ObjChunk::relative.
+    };
+
+    // The same arithmetic as tinyobj's tryParseDouble, so that both parsers turn the same text into the same float:
+    // digits accumulate into a double, with fraction digits scaled by a table of negative powers of ten.
+    // Leaves result alone and returns false if [s, end) doesn't start with a number.
+    bool parse_double(const char* s, const char* end, double& result)
+    {
+        static const double pow_lut[] = { 1.0, 0.1, 0.01, 0.001, 0.0001, 0.00001, 0.000001, 0.0000001 };
+        const int lut_entries = sizeof(pow_lut) / sizeof(pow_lut[0]);
+
+        if (s >= end) return false;
+
+        const char* p = s;
+        bool negative = false;
+        if (*p == '+' || *p == '-')
+        {
+            negative = *p == '-';
+            p++;
+        } else if (!is_digit(*p))
+        {
+            return false;
+        }
+
+        double mantissa = 0.0;
+        int exponent = 0;
+
+        int read = 0;
+        for (; p != end && is_digit(*p); p++, read++)
+        {
+            mantissa *= 10;
+            mantissa += static_cast<int>(*p - '0');
+        }
+        if (read == 0) return false;
+
+        if (p != end && *p == '.')
+        {
+            p++;
+            for (read = 1; p != end && is_digit(*p); p++, read++)
+            {
+                mantissa += static_cast<int>(*p - '0') * (read < lut_entries ? pow_lut[read] : std::pow(10.0, -read));
+            }
+        }
+
+        if (p != end && (*p == 'e' || *p == 'E'))
+        {
+            p++;
+            bool negative_exponent = false;
+            if (p != end && (*p == '+' || *p == '-'))
+            {
+                negative_exponent = *p == '-';
+                p++;
+            } else if (p == end || !is_digit(*p))
+            {
+                return false;
+            }
+
+            for (read = 0; p != end && is_digit(*p); p++, read++)
+            {
+                exponent *= 10;
+                exponent += static_cast<int>(*p - '0');
+            }
+            if (negative_exponent) exponent = -exponent;
+            if (read == 0) return false;
+        }
+
+        result = (negative ? -1 : 1) * (exponent ? std::ldexp(mantissa * std::pow(5.0, exponent), exponent) : mantissa);
+        return true;
+    }
+
+    // One whitespace-separated number, or 0 if it doesn't parse.
+    float parse_real(const char*& p, const char* line_end)
+    {
+        while (p < line_end && is_space(*p)) p++;
+        const char* token_end = p;
+        while (token_end < line_end && !is_space(*token_end)) token_end++;
+
+        double value = 0.0;
+        parse_double(p, token_end, value);
+        p = token_end;
+        return static_cast<float>(value);
+    }
+
+    // Like atoi.
+    int parse_int(const char* p, const char* end)
+    {
+        while (p < end && (is_space(*p) || *p == '\v' || *p == '\f')) p++;
+
+        bool negative = false;
+        if (p < end && (*p == '+' || *p == '-'))
+        {
+            negative = *p == '-';
+            p++;
+        }
+
+        int value = 0;
+        for (; p < end && is_digit(*p); p++)
+        {
+            value = (value * 10) + (*p - '0');
+        }
+        return negative ? -value : value;
+    }
+
+    void skip_index(const char*& p, const char* end)
+    {
+        while (p < end && *p != '/' && !is_space(*p)) p++;
+    }
+
+    // OBJ indices count from 1, and negative ones count back from the last element so far.
+    // 0 isn't valid, but tinyobj maps it to the first element, and so do we.
+    int fix_index(int index, size_t count, int component, uint8_t& relative_mask)
+    {
+        if (index > 0) return index - 1;
+        if (index == 0) return 0;
+        relative_mask |= (uint8_t) (1 << component);
+        return static_cast<int>(count) + index;
+    }
+
+    // One corner of a face: v, v/vt, v//vn or v/vt/vn.
+    ObjCorner parse_corner(const char*& p, const char* end, const ObjChunk& chunk)
+    {
+        ObjCorner corner = { { -1, -1, -1 }, 0 };
+
+        corner.index.vertex_index = fix_index(parse_int(p, end), chunk.positions.size() / 3, 0, corner.relative_mask);
+        skip_index(p, end);
+        if (p == end || *p != '/') return corner;
+        p++;
+
+        if (p != end && *p == '/')
+        {
+            p++;
+            corner.index.normal_index = fix_index(parse_int(p, end), chunk.normals.size() / 3, 1, corner.relative_mask);
+            skip_index(p, end);
+            return corner;
+        }
+
+        corner.index.texcoord_index = fix_index(parse_int(p, end), chunk.texcoords.size() / 2, 2, corner.relative_mask);
+        skip_index(p, end);
+        if (p == end || *p != '/') return corner;
+        p++;
+
+        corner.index.normal_index = fix_index(parse_int(p, end), chunk.normals.size() / 3, 1, corner.relative_mask);
+        skip_index(p, end);
+        return corner;
+    }
+
+    void add_corner(ObjChunk& chunk, const ObjCorner& corner)
+    {
+        chunk.indices.push_back(corner.index);
+        chunk.relative.push_back(corner.relative_mask);
+        chunk.any_relative |= corner.relative_mask != 0;
+    }
+
+    void parse_line(ObjChunk& chunk, const char* p, const char* end, std::vector<ObjCorner>& face)
+    {
+        while (p < end && is_space(*p)) p++;
+        if (end - p < 2) return;
+
+        if (p[0] == 'v' && is_space(p[1]))
+        {
+            p += 2;
+            for (int k = 0; k < 3; k++)
+            {
+                chunk.positions.push_back(parse_real(p, end));
+            }
+        } else if (p[0] == 'v' && p[1] == 'n' && end - p > 2 && is_space(p[2]))
+        {
+            p += 3;
+            for (int k = 0; k < 3; k++)
+            {
+                chunk.normals.push_back(parse_real(p, end));
+            }
+        } else if (p[0] == 'v' && p[1] == 't' && end - p > 2 && is_space(p[2]))
+        {
+            p += 3;
+            for (int k = 0; k < 2; k++)
+            {
+                chunk.texcoords.push_back(parse_real(p, end));
+            }
+        } else if (p[0] == 'f' && is_space(p[1]))
+        {
+            p += 2;
+            while (p < end && is_space(*p)) p++;
+
+            face.clear();
+            while (p < end)
+            {
+                face.push_back(parse_corner(p, end, chunk));
+                while (p < end && is_space(*p)) p++;
+            }
+
+            // Polygons become a fan of triangles around their first corner, as tinyobj makes them.
+            for (size_t k = 2; k < face.size(); k++)
+            {
+                add_corner(chunk, face[0]);
+                add_corner(chunk, face[k - 1]);
+                add_corner(chunk, face[k]);
+            }
+        }
+    }
+
+    // Lines end at '\n', '\r' or both, like in tinyobj.
+    void parse_chunk(ObjChunk& chunk)
+    {
+        std::vector<ObjCorner> face;
+        const char* p = chunk.begin;
+        while (p < chunk.end)
+        {
+            const char* line_end = p;
+            while (line_end < chunk.end && *line_end != '\n' && *line_end != '\r') line_end++;
+            parse_line(chunk, p, line_end, face);
+            p = line_end + 1;
+        }
+    }
+
+    template <typename T>
+    void append_at(std::vector<T>& to, size_t offset, std::vector<T>& from)
+    {
+        std::copy(from.begin(), from.end(), to.begin() + offset);
+        from = std::vector<T>();
+    }
+}
+
+bool parse_obj_parallel(const std::string& path, ThreadPool& pool, tinyobj::attrib_t& attrib, tinyobj::shape_t& shape)
+{
+    attrib = tinyobj::attrib_t();
+    shape = tinyobj::shape_t();
+
+    std::unique_ptr<MappedFile> file = MappedFile::open(path);
+    if (file == nullptr)
+    {
+        // An empty file can't be mapped, but is still a valid, empty OBJ.
+        return std::ifstream(path).good();
+    }
+
+    const char* data = reinterpret_cast<const char*>(file->data());
+    const char* data_end = data + file->size();
+    size_t num_chunks = std::clamp<size_t>(file->size() / MIN_CHUNK_BYTES, 1, pool.size() * 4);
+
+    // Each chunk ends just past a line break, so that no line is split between two chunks.
+    std::vector<ObjChunk> chunks(num_chunks);
+    const char* begin = data;
+    for (size_t c = 0; c < num_chunks; c++)
+    {
+        const char* end = (c + 1 == num_chunks) ? data_end : data + ((file->size() * (c + 1)) / num_chunks);
+        end = std::max(end, begin);
+        while (end < data_end && end > data && end[-1] != '\n' && end[-1] != '\r') end++;
+
+        chunks[c].begin = begin;
+        chunks[c].end = end;
+        begin = end;
+    }
+
+    pool.parallel_for((int) num_chunks, [&](int c) { parse_chunk(chunks[c]); });
+
+    // Where each chunk's elements go in the combined arrays.
+    std::vector<size_t> position_offset(num_chunks + 1, 0);
+    std::vector<size_t> normal_offset(num_chunks + 1, 0);
+    std::vector<size_t> texcoord_offset(num_chunks + 1, 0);
+    std::vector<size_t> index_offset(num_chunks + 1, 0);
+    for (size_t c = 0; c < num_chunks; c++)
+    {
+        position_offset[c + 1] = position_offset[c] + chunks[c].positions.size();
+        normal_offset[c + 1] = normal_offset[c] + chunks[c].normals.size();
+        texcoord_offset[c + 1] = texcoord_offset[c] + chunks[c].texcoords.size();
+        index_offset[c + 1] = index_offset[c] + chunks[c].indices.size();
+    }
+
+    attrib.vertices.resize(position_offset[num_chunks]);
+    attrib.normals.resize(normal_offset[num_chunks]);
+    attrib.texcoords.resize(texcoord_offset[num_chunks]);
+    shape.mesh.indices.resize(index_offset[num_chunks]);
+
+    pool.parallel_for((int) num_chunks, [&](int c) {
+        ObjChunk& chunk = chunks[c];
+        const int base[3] = {
+            static_cast<int>(position_offset[c] / 3),
+            static_cast<int>(normal_offset[c] / 3),
+            static_cast<int>(texcoord_offset[c] / 2)
+        };
+        for (size_t i = 0; chunk.any_relative && i < chunk.indices.size(); i++)
+        {
+            tinyobj::index_t& index = chunk.indices[i];
+            if (chunk.relative[i] & 1) index.vertex_index += base[0];
+            if (chunk.relative[i] & 2) index.normal_index += base[1];
+            if (chunk.relative[i] & 4) index.texcoord_index += base[2];
+        }
+
+        append_at(attrib.vertices, position_offset[c], chunk.positions);
+        append_at(attrib.normals, normal_offset[c], chunk.normals);
+        append_at(attrib.texcoords, texcoord_offset[c], chunk.texcoords);
+        append_at(shape.mesh.indices, index_offset[c], chunk.indices);
+    });
+
+    size_t num_triangles = shape.mesh.indices.size() / 3;
+    shape.mesh.num_face_vertices.assign(num_triangles, 3);
+    shape.mesh.material_ids.assign(num_triangles, -1);
+    return true;
+}
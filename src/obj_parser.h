@@ -0,0 +1,10 @@
+#pragma once
+#include <string>
+#include "thread_pool.h"
+#include "../ext/tiny_obj_loader.h"
+
+// Reads the OBJ file at path with a memory mapping and parses it on the pool's threads, each taking a chunk of whole lines.
+// Only v, vn, vt and f records are read; everything else, materials and groups included, is skipped.
+// The result is what tinyobj::LoadObj (with triangulation) gives for the same records, bit for bit,
+// except that every face lands in the one shape. Returns false if the file can't be read.
+bool parse_obj_parallel(const std::string& path, ThreadPool& pool, tinyobj::attrib_t& attrib, tinyobj::shape_t& shape);
@@ -1,16 +1,36 @@
-#include "object.h"
-
-Object::Object(std::shared_ptr<Mesh> Mesh, std::unique_ptr<mat4> Mat)
-    : mesh(std::move(Mesh)), mat(std::move(Mat))
-{
-}
-
-std::shared_ptr<Mesh>& Object::getMesh()
-{
-    return mesh;
-}
-
-std::unique_ptr<mat4>& Object::getMat()
-{
-    return mat;
+#include "object.h"
+
+Object::Object(std::shared_ptr<Mesh> Mesh, std::unique_ptr<mat4> Mat)
+    : mesh(std::move(Mesh)), mat(std::move(Mat))
+{
+}
+
+std::shared_ptr<Mesh>& Object::getMesh()
+{
+    return mesh;
+}
+
+std::unique_ptr<mat4>& Object::getMat()
+{
+    return mat;
+}
+
+AABB Object::getWorldBounds() const
+{
+    return transform_bounds(*mat, mesh->getBounds());
+}
+
+BoundingSphere Object::getWorldBoundingSphere() const
+{
+    return transform_bounds(*mat, mesh->getBoundingSphere());
+}
+
+void Object::setOccluder(bool occluder)
+{
+    is_occluder = occluder;
+}
+
+bool Object::isOccluder() const
+{
+    return is_occluder;
 }
\ No newline at end of file
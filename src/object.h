@@ -1,19 +1,31 @@
-#pragma once
-#include <memory>
-#include "mesh.h"
-#include "mat4.h"
-
-// Represents an object in a world.
-// Contains its own matrix O to multiply by the world frame to obtain the object frame.
-class Object
-{
-    public:
-        Object() = default;
-        Object(std::shared_ptr<Mesh> Mesh, std::unique_ptr<mat4> Mat);
-
-        std::shared_ptr<Mesh>& getMesh();
-        std::unique_ptr<mat4>& getMat();
-    private:
-        std::shared_ptr<Mesh> mesh = nullptr;
-        std::unique_ptr<mat4> mat = nullptr;
-};
+#pragma once
+#include <memory>
+#include "mesh.h"
+#include "mat4.h"
+#include "bounds.h"
+
+// Represents an object in a world.
+// Contains its own matrix O to multiply by the world frame to obtain the object frame.
+class Object
+{
+    public:
+        Object() = default;
+        Object(std::shared_ptr<Mesh> Mesh, std::unique_ptr<mat4> Mat);
+
+        std::shared_ptr<Mesh>& getMesh();
+        std::unique_ptr<mat4>& getMat();
+
+        // The mesh's bounds carried into world space by the object's matrix. They are derived on every call,
+        // since the matrix can be changed through getMat() at any time.
+        AABB getWorldBounds() const;
+        BoundingSphere getWorldBoundingSphere() const;
+
+        // Occluders are also drawn into the renderer's occlusion buffer before the frame, to hide other objects
+        // (see OcclusionBuffer). Worth it for a few large, simple objects that hide a lot, such as walls.
+        void setOccluder(bool occluder);
+        bool isOccluder() const;
+    private:
+        std::shared_ptr<Mesh> mesh = nullptr;
+        std::unique_ptr<mat4> mat = nullptr;
+        bool is_occluder = false;
+};
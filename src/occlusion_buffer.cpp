@@ -0,0 +1,203 @@
+#include "occlusion_buffer.h"
+#include <algorithm>
+#include <cmath>
+
+// Vertices closer to the eye plane than this (in w) aren't projected, as their screen positions blow up.
+static constexpr float MIN_W = 1e-3f;
+// Occluder depths are pushed back by this fraction, to make up for rounding in the plane equations.
+static constexpr float DEPTH_BIAS = 1e-5f;
+
+// The position in buffer pixels, x right and y up as in the frame before it is flipped, with 1 / w in z.
+static vec3 to_buffer(const vec4& clip, int width, int height)
+{
+    float inverse_w = 1 / clip.w;
+    return vec3(((clip.x * inverse_w * 0.5f) + 0.5f) * width, ((clip.y * inverse_w * 0.5f) + 0.5f) * height, inverse_w);
+}
+
+void OcclusionBuffer::resize(int width, int height)
+{
+    width = (width + 3) & ~3;
+    if (width == w && height == h) return;
+
+    w = width;
+    h = height;
+    depth.assign(w * h, 0.0f);
+}
+
+void OcclusionBuffer::clear(const mat4& vp)
+{
+    view_projection = vp;
+    std::fill(depth.begin(), depth.end(), 0.0f);
+}
+
+int OcclusionBuffer::width() const
+{
+    return w;
+}
+
+int OcclusionBuffer::height() const
+{
+    return h;
+}
+
+size_t OcclusionBuffer::draw_occluder(const Mesh& mesh, const mat4& model)
+{
+    const VertexStreams& streams = mesh.getVertexStreams();
+    ArrayView<uint32_t> indices = mesh.getIndices();
+    clip_positions.resize(streams.size());
+    transform_points(view_projection * model, streams.x.data(), streams.y.data(), streams.z.data(), clip_positions.data(), streams.size());
+
+    size_t drawn = 0;
+    for (size_t i = 0; i < indices.size(); i += 3)
+    {
+        const vec4& a = clip_positions[indices[i]];
+        const vec4& b = clip_positions[indices[i + 1]];
+        const vec4& c = clip_positions[indices[i + 2]];
+        if (a.w <= MIN_W || b.w <= MIN_W || c.w <= MIN_W) continue;
+
+        draw_triangle(a, b, c);
+        drawn++;
+    }
+    return drawn;
+}
+
+// Writes the triangle's farthest depth over each pixel that it covers entirely, wherever that is closer than the
+// depth already there. Both the coverage and the depth are bounded with the pixel's worst corner: an edge function
+// or a depth plane a*x + b*y + c varies by at most (|a| + |b|) / 2 between the pixel's center and its corners.
+void OcclusionBuffer::draw_triangle(const vec4& a, const vec4& b, const vec4& c)
+{
+    const vec3 p[3] = { to_buffer(a, w, h), to_buffer(b, w, h), to_buffer(c, w, h) };
+    float area = ((p[1].x - p[0].x) * (p[2].y - p[0].y)) - ((p[1].y - p[0].y) * (p[2].x - p[0].x));
+    if (!(area > 0)) return; // Back-facing, degenerate, or not finite.
+
+    // Pixel (x, y) spans [x, x + 1] x [y, y + 1], so only those entirely inside the vertices' extent can be covered.
+    int min_x = std::max((int) std::ceil(std::min({ p[0].x, p[1].x, p[2].x })), 0);
+    int min_y = std::max((int) std::ceil(std::min({ p[0].y, p[1].y, p[2].y })), 0);
+    int max_x = std::min((int) std::floor(std::max({ p[0].x, p[1].x, p[2].x })) - 1, w - 1);
+    int max_y = std::min((int) std::floor(std::max({ p[0].y, p[1].y, p[2].y })) - 1, h - 1);
+    if (min_x > max_x || min_y > max_y) return;
+
+    // Edge i is opposite vertex i and positive inside, as in TriangleSetup. Each is offset so that evaluating it
+    // at a pixel's integer coordinates gives its value at the pixel's worst corner.
+    float edge_a[3], edge_b[3], edge_c[3];
+    float depth_a = 0, depth_b = 0, depth_c = 0;
+    for (int i = 0; i < 3; i++)
+    {
+        const vec3& from = p[(i + 1) % 3];
+        const vec3& to = p[(i + 2) % 3];
+        edge_a[i] = from.y - to.y;
+        edge_b[i] = to.x - from.x;
+        edge_c[i] = -(edge_a[i] * from.x) - (edge_b[i] * from.y);
+
+        // The depth plane is the vertices' depths weighted by their barycentric coordinates, E_i / area.
+        depth_a += edge_a[i] * p[i].z;
+        depth_b += edge_b[i] * p[i].z;
+        depth_c += edge_c[i] * p[i].z;
+
+        edge_c[i] += (0.5f * (edge_a[i] + edge_b[i])) - (0.5f * (std::fabs(edge_a[i]) + std::fabs(edge_b[i])));
+    }
+    depth_a /= area;
+    depth_b /= area;
+    depth_c /= area;
+    depth_c += (0.5f * (depth_a + depth_b)) - (0.5f * (std::fabs(depth_a) + std::fabs(depth_b)));
+
+    for (int y = min_y; y <= max_y; y++)
+    {
+        float* row = depth.data() + (y * w);
+        int x = min_x;
+#ifdef MATH_SIMD
+        // Four pixels at a time, from the multiple of 4 at or before min_x. Lanes outside [min_x, max_x] are masked off.
+        x = min_x & ~3;
+        const __m128 lane = _mm_setr_ps(0, 1, 2, 3);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 first = _mm_set1_ps((float) min_x - 0.5f);
+        const __m128 last = _mm_set1_ps((float) max_x + 0.5f);
+        const __m128 keep = _mm_set1_ps(1 - DEPTH_BIAS);
+        __m128 row_edges[3];
+        for (int i = 0; i < 3; i++)
+        {
+            row_edges[i] = _mm_set1_ps((edge_b[i] * y) + edge_c[i]);
+        }
+        __m128 row_depth = _mm_set1_ps((depth_b * y) + depth_c);
+        for (; x <= max_x; x += 4)
+        {
+            __m128 px = _mm_add_ps(_mm_set1_ps((float) x), lane);
+            __m128 covered = _mm_and_ps(_mm_cmpgt_ps(px, first), _mm_cmplt_ps(px, last));
+            for (int i = 0; i < 3; i++)
+            {
+                __m128 edge = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(edge_a[i]), px), row_edges[i]);
+                covered = _mm_and_ps(covered, _mm_cmpge_ps(edge, zero));
+            }
+            if (_mm_movemask_ps(covered) == 0) continue;
+
+            __m128 farthest = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(depth_a), px), row_depth), keep);
+            __m128 old_depth = _mm_loadu_ps(row + x);
+            __m128 new_depth = _mm_max_ps(old_depth, farthest);
+            _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(covered, new_depth), _mm_andnot_ps(covered, old_depth)));
+        }
+#else
+        for (; x <= max_x; x++)
+        {
+            bool covered = true;
+            for (int i = 0; i < 3; i++)
+            {
+                covered = covered && (edge_a[i] * x) + (edge_b[i] * y) + edge_c[i] >= 0;
+            }
+            if (!covered) continue;
+
+            float farthest = ((depth_a * x) + (depth_b * y) + depth_c) * (1 - DEPTH_BIAS);
+            row[x] = std::max(row[x], farthest);
+        }
+#endif
+    }
+}
+
+// Hidden if, at every pixel that the box's screen rectangle overlaps, the occluders are closer than the box's nearest corner.
+bool OcclusionBuffer::occluded(const AABB& box) const
+{
+    float min_x = 0, min_y = 0, max_x = 0, max_y = 0, nearest = 0;
+    for (int corner = 0; corner < 8; corner++)
+    {
+        vec4 position((corner & 1) ? box.max.x : box.min.x, (corner & 2) ? box.max.y : box.min.y, (corner & 4) ? box.max.z : box.min.z, 1);
+        vec4 clip = view_projection * position;
+        if (clip.w <= MIN_W) return false;
+
+        vec3 p = to_buffer(clip, w, h);
+        if (corner == 0)
+        {
+            min_x = max_x = p.x;
+            min_y = max_y = p.y;
+            nearest = p.z;
+        }
+        min_x = std::min(min_x, p.x);
+        min_y = std::min(min_y, p.y);
+        max_x = std::max(max_x, p.x);
+        max_y = std::max(max_y, p.y);
+        nearest = std::max(nearest, p.z);
+    }
+
+    // Pixel x overlaps [min_x, max_x] if x < max_x and x + 1 > min_x. Off-screen parts can't be seen anyway.
+    int first_x = std::max((int) std::floor(min_x), 0);
+    int first_y = std::max((int) std::floor(min_y), 0);
+    int last_x = std::min((int) std::ceil(max_x) - 1, w - 1);
+    int last_y = std::min((int) std::ceil(max_y) - 1, h - 1);
+    if (first_x > last_x || first_y > last_y) return false;
+
+    for (int y = first_y; y <= last_y; y++)
+    {
+        const float* row = depth.data() + (y * w);
+        int x = first_x;
+#ifdef MATH_SIMD
+        const __m128 box_depth = _mm_set1_ps(nearest);
+        for (; x + 4 <= last_x + 1; x += 4)
+        {
+            if (_mm_movemask_ps(_mm_cmple_ps(_mm_loadu_ps(row + x), box_depth)) != 0) return false;
+        }
+#endif
+        for (; x <= last_x; x++)
+        {
+            if (row[x] <= nearest) return false;
+        }
+    }
+    return true;
+}
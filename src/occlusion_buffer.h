@@ -0,0 +1,48 @@
+#pragma once
+#include <vector>
+#include "bounds.h"
+#include "mat4.h"
+#include "mesh.h"
+
+// A small, coarse depth buffer that a few large occluders are drawn into before the frame, so that objects hidden
+// behind them can be skipped before any of their vertices are shaded. Every step errs on the side of "visible":
+// - an occluder only covers the pixels it covers entirely, and gives each the farthest depth it has in that pixel;
+// - an object is only hidden if its screen rectangle is behind the occluders at every pixel it overlaps.
+// So an object is never culled while any part of it could show, at the price of missing some that are hidden.
+//
+// Depths are stored as 1 / w, which unlike w itself is linear across a triangle in screen space, so its extremes over
+// a pixel are easy to bound. Larger is closer, and an empty pixel holds 0, which is infinitely far.
+class OcclusionBuffer
+{
+    public:
+        static constexpr int DEFAULT_WIDTH = 256;
+        static constexpr int DEFAULT_HEIGHT = 128;
+
+        OcclusionBuffer() = default;
+
+        // The width is rounded up to a multiple of 4, so that rows can be processed 4 pixels at a time.
+        // The buffer covers the whole screen whatever its size, so its pixels needn't be square.
+        void resize(int width, int height);
+
+        // Empties the buffer for a frame seen through view_projection.
+        void clear(const mat4& view_projection);
+
+        // Draws the mesh's front-facing triangles, placed in the world by model. Triangles reaching behind the eye
+        // are left out. Returns the number of triangles drawn.
+        size_t draw_occluder(const Mesh& mesh, const mat4& model);
+
+        // True if the world-space box is entirely hidden behind what has been drawn.
+        bool occluded(const AABB& box) const;
+
+        int width() const;
+        int height() const;
+
+    private:
+        void draw_triangle(const vec4& a, const vec4& b, const vec4& c);
+
+        int w = 0;
+        int h = 0;
+        std::vector<float> depth;
+        mat4 view_projection;
+        std::vector<vec4> clip_positions; // Scratch space for draw_occluder.
+};
@@ -0,0 +1,416 @@
+#include "rasterizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define RASTERIZER_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+// MSVC lets any function use any intrinsic.
+#define TARGET_SSE41
+#define TARGET_AVX2
+#else
+// GCC and Clang need to be told which functions may use instructions beyond the baseline.
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+// Round a screen coordinate to the nearest point on the fixed-point grid.
+static int64_t to_fixed(float v)
+{
+    // Clamp first so that vertices far outside of the screen can't overflow.
+    constexpr float LIMIT = float(1 << 28);
+    return (int64_t) std::floor(std::clamp(v * SUBPIXEL_STEPS, -LIMIT, LIMIT) + 0.5f);
+}
+
+// Floor division by SUBPIXEL_STEPS that also rounds negative values down.
+static int64_t floor_to_pixel(int64_t v)
+{
+    return (v >= 0) ? (v >> SUBPIXEL_BITS) : -((-v + SUBPIXEL_STEPS - 1) >> SUBPIXEL_BITS);
+}
+
+bool TriangleSetup::setup(const vec4 (&coords)[3], int width, int height)
+{
+    int64_t x[3], y[3];
+    for (int i = 0; i < 3; i++)
+    {
+        if (!std::isfinite(coords[i].x) || !std::isfinite(coords[i].y)) return false;
+        x[i] = to_fixed(coords[i].x);
+        y[i] = to_fixed(coords[i].y);
+    }
+
+    // Foundations of 3D Computer Graphics, 12.2
+    // The sign of the screen-space area tells us which way the triangle faces.
+    // Positive: vertices are CCW, aka facing the front-side
+    // Negative: vertices are CW, aka facing the back-side
+    // Zero-area triangles cover nothing, so they are discarded along with the back-facing ones.
+    int64_t area = ((x[1] - x[0]) * (y[2] - y[0])) - ((y[1] - y[0]) * (x[2] - x[0]));
+    if (area <= 0) return false;
+
+    // Pixels are sampled at their centres, so only centres inside the vertices' extent can be covered.
+    constexpr int64_t HALF_PIXEL = SUBPIXEL_STEPS / 2;
+    min_x = (int) std::max<int64_t>(floor_to_pixel(std::min({ x[0], x[1], x[2] }) - HALF_PIXEL + SUBPIXEL_STEPS - 1), 0);
+    min_y = (int) std::max<int64_t>(floor_to_pixel(std::min({ y[0], y[1], y[2] }) - HALF_PIXEL + SUBPIXEL_STEPS - 1), 0);
+    max_x = (int) std::min<int64_t>(floor_to_pixel(std::max({ x[0], x[1], x[2] }) - HALF_PIXEL), width - 1);
+    max_y = (int) std::min<int64_t>(floor_to_pixel(std::max({ y[0], y[1], y[2] }) - HALF_PIXEL), height - 1);
+    if (min_x > max_x || min_y > max_y) return false;
+
+    for (int i = 0; i < 3; i++)
+    {
+        int from = (i + 1) % 3;
+        int to = (i + 2) % 3;
+
+        EdgeFunction& edge = edges[i];
+        edge.a = y[from] - y[to];
+        edge.b = x[to] - x[from];
+        edge.c = -(edge.a * x[from]) - (edge.b * y[from]);
+
+        // Top-left fill rule: a pixel centre lying exactly on an edge is only covered if that edge is a top or a left edge.
+        // Two triangles sharing an edge see it in opposite directions, so exactly one of them draws those pixels.
+        // https://fgiesen.wordpress.com/2013/02/08/triangle-rasterization-in-practice/
+        bool is_left = edge.a > 0;
+        bool is_top = edge.a == 0 && edge.b < 0;
+        if (!is_top && !is_left)
+        {
+            edge.c -= 1;
+        }
+    }
+
+    inv_area = 1.0f / (float) area;
+    for (int i = 0; i < 3; i++)
+    {
+        inv_w[i] = 1.0f / coords[i].w;
+    }
+
+    // Interpolated w is a weighted harmonic mean of the vertex w values, so it never falls below the smallest one
+    // by more than the rounding in the weights, which is a few ulps.
+    min_depth = std::min(std::min(coords[0].w, coords[1].w), coords[2].w) * (1.0f - 1e-5f);
+    return true;
+}
+
+SimdLevel detect_simd_level()
+{
+#if RASTERIZER_X86
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int max_leaf = info[0];
+
+    __cpuid(info, 1);
+    bool sse41 = (info[2] & (1 << 19)) != 0;
+    bool os_saves_ymm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && ((_xgetbv(0) & 6) == 6);
+
+    bool avx2 = false;
+    if (max_leaf >= 7 && os_saves_ymm)
+    {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+    }
+#else
+    // These also check that the OS saves the wide registers on a context switch.
+    __builtin_cpu_init();
+    bool sse41 = __builtin_cpu_supports("sse4.1");
+    bool avx2 = __builtin_cpu_supports("avx2");
+#endif
+    if (avx2) return SimdLevel::AVX2;
+    if (sse41) return SimdLevel::SSE41;
+#endif
+    return SimdLevel::Scalar;
+}
+
+const char* simd_level_name(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::AVX2:
+        return "AVX2";
+    case SimdLevel::SSE41:
+        return "SSE4.1";
+    default:
+        return "Scalar";
+    }
+}
+
+// Edge values at the centre of pixel (x, y).
+static void evaluate_edges(const TriangleSetup& setup, int x, int y, int64_t (&e)[3])
+{
+    int64_t px = ((int64_t) x << SUBPIXEL_BITS) + (SUBPIXEL_STEPS / 2);
+    int64_t py = ((int64_t) y << SUBPIXEL_BITS) + (SUBPIXEL_STEPS / 2);
+    for (int k = 0; k < 3; k++)
+    {
+        e[k] = setup.edges[k].evaluate(px, py);
+    }
+}
+
+BlockCoverage classify_block(const TriangleSetup& setup, int x, int y, int size)
+{
+    int64_t corner[3];
+    evaluate_edges(setup, x, y, corner);
+
+    bool inside = true;
+    for (int k = 0; k < 3; k++)
+    {
+        // E is linear, so over the block it is smallest and largest at two of the corners.
+        int64_t dx = setup.edges[k].a * SUBPIXEL_STEPS * (size - 1);
+        int64_t dy = setup.edges[k].b * SUBPIXEL_STEPS * (size - 1);
+        int64_t lowest = corner[k] + std::min<int64_t>(dx, 0) + std::min<int64_t>(dy, 0);
+        int64_t highest = corner[k] + std::max<int64_t>(dx, 0) + std::max<int64_t>(dy, 0);
+
+        if (highest < 0) return BlockCoverage::Outside;
+        if (lowest < 0) inside = false;
+    }
+    return inside ? BlockCoverage::Inside : BlockCoverage::Partial;
+}
+
+static int count_bits(uint32_t mask)
+{
+    int count = 0;
+    for (; mask != 0; mask &= mask - 1)
+    {
+        count++;
+    }
+    return count;
+}
+
+// One pixel at a time with 64-bit edge values. Used when the row's edge values don't fit the 32-bit SIMD lanes.
+static int rasterize_row_scalar(const TriangleSetup& setup, int y, int min_x, int max_x, bool covered, const float* depth_row, PixelBlock* out, int& depth_rejected)
+{
+    int64_t e[3];
+    evaluate_edges(setup, min_x, y, e);
+
+    int count = 0;
+    for (int x = min_x; x <= max_x; x += PixelBlock::WIDTH)
+    {
+        PixelBlock& block = out[count];
+        block.x = x;
+        block.mask = 0;
+
+        int n = std::min(PixelBlock::WIDTH, max_x - x + 1);
+        for (int lane = 0; lane < n; lane++)
+        {
+            if (covered || (e[0] | e[1] | e[2]) >= 0)
+            {
+                float b0 = (float) e[0] * setup.inv_area;
+                float b1 = (float) e[1] * setup.inv_area;
+                float b2 = (float) e[2] * setup.inv_area;
+                float wn = 1.0f / ((b0 * setup.inv_w[0]) + (b1 * setup.inv_w[1]) + (b2 * setup.inv_w[2]));
+
+                if (wn < depth_row[x + lane])
+                {
+                    block.b0[lane] = b0;
+                    block.b1[lane] = b1;
+                    block.b2[lane] = b2;
+                    block.wn[lane] = wn;
+                    block.mask |= 1u << lane;
+                } else
+                {
+                    depth_rejected++;
+                }
+            }
+
+            for (int k = 0; k < 3; k++)
+            {
+                e[k] += setup.edges[k].a * SUBPIXEL_STEPS;
+            }
+        }
+        for (int k = 0; k < 3; k++)
+        {
+            e[k] += setup.edges[k].a * SUBPIXEL_STEPS * (PixelBlock::WIDTH - n);
+        }
+
+        if (block.mask != 0) count++;
+    }
+    return count;
+}
+
+#if RASTERIZER_X86
+// Loads the z-buffer values for a block, without reading past the end of the row for a partial block.
+// The padding lanes are never covered, so their value doesn't matter.
+static const float* block_depth(const float* depth_row, int x, int n, float (&padded)[PixelBlock::WIDTH])
+{
+    if (n == PixelBlock::WIDTH) return depth_row + x;
+
+    for (int lane = 0; lane < PixelBlock::WIDTH; lane++)
+    {
+        padded[lane] = (lane < n) ? depth_row[x + lane] : 0.0f;
+    }
+    return padded;
+}
+
+// Two 4-wide halves per 8-pixel block.
+TARGET_SSE41 static int rasterize_row_sse41(const TriangleSetup& setup, int y, int min_x, int max_x, bool covered, const float* depth_row, PixelBlock* out, int& depth_rejected)
+{
+    int64_t row[3];
+    evaluate_edges(setup, min_x, y, row);
+
+    const __m128i lanes = _mm_setr_epi32(0, 1, 2, 3);
+    __m128i e[3];
+    __m128i step_half[3];
+    __m128i step_block[3];
+    for (int k = 0; k < 3; k++)
+    {
+        // Lanes wrap around on overflow, which is harmless since every value that ends up being used fits.
+        int64_t step = setup.edges[k].a * SUBPIXEL_STEPS;
+        e[k] = _mm_add_epi32(_mm_set1_epi32((int32_t) row[k]), _mm_mullo_epi32(lanes, _mm_set1_epi32((int32_t) step)));
+        step_half[k] = _mm_set1_epi32((int32_t) (step * 4));
+        step_block[k] = _mm_set1_epi32((int32_t) (step * PixelBlock::WIDTH));
+    }
+
+    const __m128 inv_area = _mm_set1_ps(setup.inv_area);
+    const __m128 inv_w0 = _mm_set1_ps(setup.inv_w[0]);
+    const __m128 inv_w1 = _mm_set1_ps(setup.inv_w[1]);
+    const __m128 inv_w2 = _mm_set1_ps(setup.inv_w[2]);
+    const __m128 one = _mm_set1_ps(1.0f);
+
+    int count = 0;
+    for (int x = min_x; x <= max_x; x += PixelBlock::WIDTH)
+    {
+        int n = std::min(PixelBlock::WIDTH, max_x - x + 1);
+        float padded[PixelBlock::WIDTH];
+        const float* depth = nullptr;
+
+        PixelBlock& block = out[count];
+        block.x = x;
+        block.mask = 0;
+
+        for (int half = 0; half < 2; half++)
+        {
+            __m128i h[3];
+            for (int k = 0; k < 3; k++)
+            {
+                h[k] = half ? _mm_add_epi32(e[k], step_half[k]) : e[k];
+            }
+
+            // A lane is covered when none of its edge values has the sign bit set.
+            __m128i any_negative = _mm_or_si128(_mm_or_si128(h[0], h[1]), h[2]);
+            uint32_t coverage = covered ? 0xF : (~_mm_movemask_ps(_mm_castsi128_ps(any_negative)) & 0xF);
+            coverage &= ((1u << n) - 1) >> (half * 4);
+            if (coverage == 0) continue;
+
+            __m128 b0 = _mm_mul_ps(_mm_cvtepi32_ps(h[0]), inv_area);
+            __m128 b1 = _mm_mul_ps(_mm_cvtepi32_ps(h[1]), inv_area);
+            __m128 b2 = _mm_mul_ps(_mm_cvtepi32_ps(h[2]), inv_area);
+            __m128 wn_reciprocal = _mm_add_ps(_mm_add_ps(_mm_mul_ps(b0, inv_w0), _mm_mul_ps(b1, inv_w1)), _mm_mul_ps(b2, inv_w2));
+            __m128 wn = _mm_div_ps(one, wn_reciprocal);
+
+            if (depth == nullptr) depth = block_depth(depth_row, x, n, padded);
+            uint32_t passed = _mm_movemask_ps(_mm_cmplt_ps(wn, _mm_loadu_ps(depth + (half * 4))));
+
+            _mm_storeu_ps(block.b0 + (half * 4), b0);
+            _mm_storeu_ps(block.b1 + (half * 4), b1);
+            _mm_storeu_ps(block.b2 + (half * 4), b2);
+            _mm_storeu_ps(block.wn + (half * 4), wn);
+            block.mask |= (coverage & passed) << (half * 4);
+            depth_rejected += count_bits(coverage & ~passed);
+        }
+        if (block.mask != 0) count++;
+
+        for (int k = 0; k < 3; k++)
+        {
+            e[k] = _mm_add_epi32(e[k], step_block[k]);
+        }
+    }
+    return count;
+}
+
+TARGET_AVX2 static int rasterize_row_avx2(const TriangleSetup& setup, int y, int min_x, int max_x, bool covered, const float* depth_row, PixelBlock* out, int& depth_rejected)
+{
+    int64_t row[3];
+    evaluate_edges(setup, min_x, y, row);
+
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m256i e[3];
+    __m256i step_block[3];
+    for (int k = 0; k < 3; k++)
+    {
+        // Lanes wrap around on overflow, which is harmless since every value that ends up being used fits.
+        int64_t step = setup.edges[k].a * SUBPIXEL_STEPS;
+        e[k] = _mm256_add_epi32(_mm256_set1_epi32((int32_t) row[k]), _mm256_mullo_epi32(lanes, _mm256_set1_epi32((int32_t) step)));
+        step_block[k] = _mm256_set1_epi32((int32_t) (step * PixelBlock::WIDTH));
+    }
+
+    const __m256 inv_area = _mm256_set1_ps(setup.inv_area);
+    const __m256 inv_w0 = _mm256_set1_ps(setup.inv_w[0]);
+    const __m256 inv_w1 = _mm256_set1_ps(setup.inv_w[1]);
+    const __m256 inv_w2 = _mm256_set1_ps(setup.inv_w[2]);
+    const __m256 one = _mm256_set1_ps(1.0f);
+
+    int count = 0;
+    for (int x = min_x; x <= max_x; x += PixelBlock::WIDTH)
+    {
+        int n = std::min(PixelBlock::WIDTH, max_x - x + 1);
+
+        // A lane is covered when none of its edge values has the sign bit set.
+        __m256i any_negative = _mm256_or_si256(_mm256_or_si256(e[0], e[1]), e[2]);
+        uint32_t coverage = (covered ? 0xFF : ~_mm256_movemask_ps(_mm256_castsi256_ps(any_negative))) & ((1u << n) - 1);
+
+        if (coverage != 0)
+        {
+            __m256 b0 = _mm256_mul_ps(_mm256_cvtepi32_ps(e[0]), inv_area);
+            __m256 b1 = _mm256_mul_ps(_mm256_cvtepi32_ps(e[1]), inv_area);
+            __m256 b2 = _mm256_mul_ps(_mm256_cvtepi32_ps(e[2]), inv_area);
+            __m256 wn_reciprocal = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(b0, inv_w0), _mm256_mul_ps(b1, inv_w1)), _mm256_mul_ps(b2, inv_w2));
+            __m256 wn = _mm256_div_ps(one, wn_reciprocal);
+
+            float padded[PixelBlock::WIDTH];
+            __m256 depth = _mm256_loadu_ps(block_depth(depth_row, x, n, padded));
+            uint32_t passed = _mm256_movemask_ps(_mm256_cmp_ps(wn, depth, _CMP_LT_OQ));
+            depth_rejected += count_bits(coverage & ~passed);
+
+            if ((coverage & passed) != 0)
+            {
+                PixelBlock& block = out[count++];
+                block.x = x;
+                block.mask = coverage & passed;
+                _mm256_storeu_ps(block.b0, b0);
+                _mm256_storeu_ps(block.b1, b1);
+                _mm256_storeu_ps(block.b2, b2);
+                _mm256_storeu_ps(block.wn, wn);
+            }
+        }
+
+        for (int k = 0; k < 3; k++)
+        {
+            e[k] = _mm256_add_epi32(e[k], step_block[k]);
+        }
+    }
+    return count;
+}
+#endif
+
+// The SIMD paths keep edge values in 32-bit lanes. Edge functions are linear, so if the corners
+// of the area that the blocks will touch fit, every pixel inside fits too.
+bool fits_simd_lanes(const TriangleSetup& setup, int min_x, int min_y, int max_x, int max_y)
+{
+    int blocks = ((max_x - min_x) / PixelBlock::WIDTH) + 1;
+    int last_x = min_x + (blocks * PixelBlock::WIDTH) - 1;
+
+    const int xs[2] = { min_x, last_x };
+    const int ys[2] = { min_y, max_y };
+    for (int x : xs)
+    {
+        for (int y : ys)
+        {
+            int64_t e[3];
+            evaluate_edges(setup, x, y, e);
+            for (int k = 0; k < 3; k++)
+            {
+                if (std::abs(e[k]) > std::numeric_limits<int32_t>::max()) return false;
+            }
+        }
+    }
+    return true;
+}
+
+int rasterize_row(SimdLevel level, const TriangleSetup& setup, int y, int min_x, int max_x, bool covered, const float* depth_row, PixelBlock* out, int& depth_rejected)
+{
+#if RASTERIZER_X86
+    if (level == SimdLevel::AVX2) return rasterize_row_avx2(setup, y, min_x, max_x, covered, depth_row, out, depth_rejected);
+    if (level == SimdLevel::SSE41) return rasterize_row_sse41(setup, y, min_x, max_x, covered, depth_row, out, depth_rejected);
+#endif
+    return rasterize_row_scalar(setup, y, min_x, max_x, covered, depth_row, out, depth_rejected);
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <cstdint>
+#include "vec4.h"
+
+// Screen positions are snapped to a 28.4 fixed-point grid before rasterization.
+// Integer edge functions are exact, so triangles sharing an edge never crack or overlap.
+constexpr int SUBPIXEL_BITS = 4;
+constexpr int SUBPIXEL_STEPS = 1 << SUBPIXEL_BITS;
+
+// The half-space function of one triangle edge, E(x, y) = a*x + b*y + c, in fixed-point units.
+// E is positive on the inner side of the edge.
+struct EdgeFunction
+{
+    int64_t a = 0;
+    int64_t b = 0;
+    int64_t c = 0;
+
+    int64_t evaluate(int64_t x, int64_t y) const
+    {
+        return (a * x) + (b * y) + c;
+    }
+};
+
+// Everything the rasterizer needs about a triangle, computed once instead of once per pixel.
+struct TriangleSetup
+{
+    // edges[i] is the edge opposite vertex i, so E_i / (2 * area) is the barycentric weight of vertex i.
+    EdgeFunction edges[3];
+
+    // Inclusive pixel bounding box, clamped to the screen.
+    int min_x = 0;
+    int min_y = 0;
+    int max_x = -1;
+    int max_y = -1;
+
+    float inv_area = 0;
+    float inv_w[3] = {};
+
+    // No pixel of the triangle has a depth (interpolated w) below this. It sits a little under the smallest vertex w,
+    // to allow for rounding in the interpolation, so that hierarchical depth tests never reject a visible pixel.
+    float min_depth = 0;
+
+    // Returns false if the triangle is back-facing, degenerate or entirely off-screen.
+    bool setup(const vec4 (&coords)[3], int width, int height);
+};
+
+// Up to 8 horizontally adjacent pixels of one row that are covered by a triangle and pass the depth test.
+// Produced by the rasterizer and consumed by the shading stage.
+struct PixelBlock
+{
+    static constexpr int WIDTH = 8;
+
+    int x = 0;          // Column of the first pixel in the block.
+    uint32_t mask = 0;  // Bit i is set if pixel x + i should be shaded.
+    float b0[WIDTH];    // Barycentric weights of each pixel.
+    float b1[WIDTH];
+    float b2[WIDTH];
+    float wn[WIDTH];    // Interpolated w, which is also the depth that goes into the z-buffer.
+};
+
+// How a square block of pixels relates to a triangle.
+enum class BlockCoverage
+{
+    Outside, // No pixel centre in the block is covered.
+    Partial, // Some might be; each pixel has to be tested.
+    Inside   // Every pixel centre in the block is covered.
+};
+
+// Classifies the size x size block of pixels whose lowest corner is pixel (x, y), by evaluating the edges at its corners.
+BlockCoverage classify_block(const TriangleSetup& setup, int x, int y, int size);
+
+// Which instruction set the block rasterizer uses. Scalar tests one pixel at a time, with 64-bit edge values, and is the
+// reference the others must match.
+enum class SimdLevel
+{
+    Scalar,
+    SSE41,
+    AVX2
+};
+
+// The barycentric weights of pixel (x, y) in x, y and z, and its interpolated w in w.
+// Bit-identical to the values rasterize_row produces for the pixel, for passes that only know which triangle covers it.
+inline vec4 pixel_barycentric(const TriangleSetup& setup, int x, int y)
+{
+    int64_t px = ((int64_t) x << SUBPIXEL_BITS) + (SUBPIXEL_STEPS / 2);
+    int64_t py = ((int64_t) y << SUBPIXEL_BITS) + (SUBPIXEL_STEPS / 2);
+    float b0 = (float) setup.edges[0].evaluate(px, py) * setup.inv_area;
+    float b1 = (float) setup.edges[1].evaluate(px, py) * setup.inv_area;
+    float b2 = (float) setup.edges[2].evaluate(px, py) * setup.inv_area;
+    float wn = 1.0f / ((b0 * setup.inv_w[0]) + (b1 * setup.inv_w[1]) + (b2 * setup.inv_w[2]));
+    return vec4(b0, b1, b2, wn);
+}
+
+// Picks the widest instruction set that this CPU supports, using CPUID.
+SimdLevel detect_simd_level();
+const char* simd_level_name(SimdLevel level);
+
+// The SIMD levels keep edge values in 32-bit lanes. This checks that they can be used for every row of the given area;
+// if not, rasterize_row must be called with SimdLevel::Scalar, which uses 64-bit edge values.
+bool fits_simd_lanes(const TriangleSetup& setup, int min_x, int min_y, int max_x, int max_y);
+
+// Tests pixels [min_x, max_x] of row y against the triangle and against depth_row, the z-buffer row for y.
+// If covered is set, the caller already knows the whole span lies inside the triangle and the edge tests are skipped.
+// Writes only the blocks with at least one surviving pixel to out, which needs room for (max_x - min_x) / 8 + 1 blocks,
+// and adds the number of covered pixels that failed the depth test to depth_rejected.
+// Returns the number of blocks written. Every level returns bit-identical results.
+int rasterize_row(SimdLevel level, const TriangleSetup& setup, int y, int min_x, int max_x, bool covered, const float* depth_row, PixelBlock* out, int& depth_rejected);
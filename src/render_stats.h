@@ -0,0 +1,128 @@
+#pragma once
+#include <cstdint>
+#include <iostream>
+
+// Counters gathered by the Renderer over one frame, to see where the work goes.
+struct RenderStats
+{
+    // Whole objects are culled by their bounding spheres before anything else is done for them.
+    uint64_t objects_submitted = 0;
+    uint64_t objects_frustum_culled = 0;
+    uint64_t instances_submitted = 0; // Copies of instanced objects, culled the same way.
+    uint64_t instances_frustum_culled = 0;
+
+    // Objects and copies hidden behind the occluders drawn into the coarse occlusion buffer, and what that cost.
+    uint64_t occluder_triangles = 0;
+    uint64_t objects_occlusion_culled = 0;
+    uint64_t instances_occlusion_culled = 0;
+    double occlusion_ms = 0;
+
+    // Objects and copies drawn from a simplified level of detail of their mesh, and the triangles that saved.
+    uint64_t draws_simplified = 0;
+    uint64_t triangles_lod_reduced = 0;
+
+    // The vertex stage runs once per unique vertex of each mesh, not once per triangle corner,
+    // and only for the vertices of meshlets that survive culling.
+    uint64_t triangles_submitted = 0;
+    uint64_t vertices_shaded = 0;
+
+    // Meshlets are culled as a whole, before the vertex stage.
+    uint64_t meshlets_submitted = 0;
+    uint64_t meshlets_frustum_culled = 0;  // Bounding sphere entirely outside the view frustum.
+    uint64_t meshlets_backface_culled = 0; // Normal cone facing away from the eye.
+    uint64_t triangles_meshlet_culled = 0; // In either kind of culled meshlet.
+
+    // Clipping happens in homogeneous space, right after the vertex stage.
+    uint64_t triangles_culled = 0;     // Entirely outside the view frustum.
+    uint64_t triangles_guard_band = 0; // Reaching past the screen, but left unclipped thanks to the guard band.
+    uint64_t triangles_clipped = 0;    // Crossing the near or far plane or the guard band.
+    uint64_t clipped_output = 0;       // Triangles that clipping turned them into.
+
+    // Hierarchical rasterization classifies 8x8 pixel blocks of every triangle's bounding box, at every SIMD level.
+    uint64_t blocks_rejected = 0; // Entirely outside the triangle, skipped.
+    uint64_t blocks_accepted = 0; // Entirely inside the triangle, filled without per-pixel edge tests.
+    uint64_t blocks_partial = 0;  // Straddling an edge, tested per pixel.
+
+    // Depth is tested before shading. The depth buffer's per-block farthest depths reject hidden work in bulk first,
+    // at every SIMD level.
+    uint64_t triangles_hiz_rejected = 0;   // Behind everything already drawn in a tile.
+    uint64_t blocks_hiz_rejected = 0;      // Covered 8x8 blocks behind everything already drawn in them.
+    uint64_t fragments_rejected_early = 0; // Covered pixels that failed the depth test, so were never shaded.
+    uint64_t fragments_shaded = 0;
+
+    // How many frames the renderer had in flight, and how long before it was handed back the frame was recorded from
+    // the world's state.
+    uint64_t pipeline_depth = 0;
+    double latency_ms = 0;
+
+    RenderStats& operator+=(const RenderStats& other)
+    {
+        objects_submitted += other.objects_submitted;
+        objects_frustum_culled += other.objects_frustum_culled;
+        instances_submitted += other.instances_submitted;
+        instances_frustum_culled += other.instances_frustum_culled;
+        occluder_triangles += other.occluder_triangles;
+        objects_occlusion_culled += other.objects_occlusion_culled;
+        instances_occlusion_culled += other.instances_occlusion_culled;
+        occlusion_ms += other.occlusion_ms;
+        draws_simplified += other.draws_simplified;
+        triangles_lod_reduced += other.triangles_lod_reduced;
+        triangles_submitted += other.triangles_submitted;
+        vertices_shaded += other.vertices_shaded;
+        meshlets_submitted += other.meshlets_submitted;
+        meshlets_frustum_culled += other.meshlets_frustum_culled;
+        meshlets_backface_culled += other.meshlets_backface_culled;
+        triangles_meshlet_culled += other.triangles_meshlet_culled;
+        triangles_culled += other.triangles_culled;
+        triangles_guard_band += other.triangles_guard_band;
+        triangles_clipped += other.triangles_clipped;
+        clipped_output += other.clipped_output;
+        blocks_rejected += other.blocks_rejected;
+        blocks_accepted += other.blocks_accepted;
+        blocks_partial += other.blocks_partial;
+        triangles_hiz_rejected += other.triangles_hiz_rejected;
+        blocks_hiz_rejected += other.blocks_hiz_rejected;
+        fragments_rejected_early += other.fragments_rejected_early;
+        fragments_shaded += other.fragments_shaded;
+        pipeline_depth += other.pipeline_depth;
+        latency_ms += other.latency_ms;
+        return *this;
+    }
+
+    void print() const
+    {
+        std::cout << "RenderStats:" << std::endl;
+        std::cout << "  objects submitted: " << objects_submitted
+                  << ", culled by the frustum: " << objects_frustum_culled << std::endl;
+        std::cout << "  instances submitted: " << instances_submitted
+                  << ", culled by the frustum: " << instances_frustum_culled << std::endl;
+        std::cout << "  occluder triangles: " << occluder_triangles
+                  << ", hidden objects: " << objects_occlusion_culled
+                  << ", hidden instances: " << instances_occlusion_culled
+                  << " (" << occlusion_ms << " ms)" << std::endl;
+        std::cout << "  draws simplified: " << draws_simplified
+                  << " (" << triangles_lod_reduced << " fewer triangles)" << std::endl;
+        // Vertices shaded per triangle that reached the vertex stage, leaving out those in culled meshlets.
+        uint64_t triangles_shaded = triangles_submitted - triangles_meshlet_culled;
+        std::cout << "  triangles submitted: " << triangles_submitted
+                  << ", vertices shaded: " << vertices_shaded
+                  << " (ACMR " << (triangles_shaded ? (double) vertices_shaded / triangles_shaded : 0.0) << ")" << std::endl;
+        std::cout << "  meshlets submitted: " << meshlets_submitted
+                  << ", culled by the frustum: " << meshlets_frustum_culled
+                  << ", facing away: " << meshlets_backface_culled
+                  << " (" << triangles_meshlet_culled << " triangles)" << std::endl;
+        std::cout << "  triangles culled by the frustum: " << triangles_culled
+                  << ", inside the guard band: " << triangles_guard_band
+                  << ", clipped: " << triangles_clipped
+                  << " (into " << clipped_output << ")" << std::endl;
+        std::cout << "  8x8 blocks rejected: " << blocks_rejected
+                  << ", trivially accepted: " << blocks_accepted
+                  << ", partially covered: " << blocks_partial << std::endl;
+        std::cout << "  hidden by Hi-Z: triangles " << triangles_hiz_rejected
+                  << ", 8x8 blocks " << blocks_hiz_rejected << std::endl;
+        std::cout << "  fragments shaded: " << fragments_shaded
+                  << ", rejected by early-Z: " << fragments_rejected_early << std::endl;
+        std::cout << "  frames in flight: " << pipeline_depth
+                  << ", latency: " << latency_ms << " ms" << std::endl;
+    }
+};
@@ -1,172 +1,1064 @@
-#include "renderer.h"
-#include <limits>
-#include <cmath>
-#include <utility>
-#include "utils.h"
-#include "vertex.h"
-
-Renderer::Renderer(World& w, Frame& f, Shader& s) :
-    world(w), frame(f), shader(s)
-{
-}
-
-void Renderer::render()
-{
-    frame.fill_frame_with_color(0xADD8E6);
-    setup_zbuffer();
-
-    for (Object* object : world.getObjects())
-    {
-        std::shared_ptr<Mesh>& mesh = object->getMesh();
-        mat4 model = *object->getMat();
-		shader.set_texture(mesh->getTexture());
-
-        for (Face& face : mesh->getFaces())
-        {
-			int num_vert = 0;
-            std::vector<vec4> coords;
-
-            for (Vertex& vertex : face.vertices)
-            {
-                coords.push_back(shader.vertex(vertex, model, num_vert++));
-            }
-
-            // Foundations of 3D Computer Graphics, 12.2
-            // Calculate the direction of the normal of the screen-space triangle, which is either towards -wn or +wn
-            // If +wn: vertices are CCW, aka facing the front-side
-            // If -wn: vertices are CW, aka facing the back-side
-            float backface = ((coords[2].x - coords[1].x) * (coords[0].y - coords[1].y)) -
-                             ((coords[2].y - coords[1].y) * (coords[0].x - coords[1].x));
-            if (backface > 0) { draw_triangle(coords); }
-        }
-    }
-}
-
-void Renderer::draw_triangle(std::vector<vec4> coords)
-{
-	std::vector<vec2> screen_coords;
-	screen_coords.push_back(vec2(coords[0]));
-	screen_coords.push_back(vec2(coords[1]));
-	screen_coords.push_back(vec2(coords[2]));
-
-	vec2 edge0 = (screen_coords[1] - screen_coords[0]);
-	vec2 edge1 = (screen_coords[2] - screen_coords[1]);
-	vec2 edge2 = (screen_coords[0] - screen_coords[2]);
-
-	int min_x = std::max(min3(screen_coords[0].x, screen_coords[1].x, screen_coords[2].x), 0);
-	int max_x = std::min(max3(screen_coords[0].x, screen_coords[1].x, screen_coords[2].x), frame.w - 1);
-	int min_y = std::max(min3(screen_coords[0].y, screen_coords[1].y, screen_coords[2].y), 0);
-	int max_y = std::min(max3(screen_coords[0].y, screen_coords[1].y, screen_coords[2].y), frame.h - 1);
-
-	for (int i = min_x; i <= max_x; i++)
-	{
-		for (int j = min_y; j <= max_y; j++)
-		{
-			vec2 point(i, j);
-			vec2 v0_to_point = point - vec2(screen_coords[0]);
-			vec2 v1_to_point = point - vec2(screen_coords[1]);
-			vec2 v2_to_point = point - vec2(screen_coords[2]);
-
-			float v0v1p = cross(edge0, v0_to_point);
-			float v1v2p = cross(edge1, v1_to_point);
-			float v2v0p = cross(edge2, v2_to_point);
-
-			if (v0v1p >= 0 && v1v2p >= 0 && v2v0p >= 0)
-			{
-				float v0v1v2 = cross(screen_coords[1] - screen_coords[0], screen_coords[2] - screen_coords[0]);
-				if (v0v1v2 == 0) return; // Discard degenerate triangles, whose area is 0.
-
-				float b1 = v1v2p / v0v1v2;
-				float b2 = v2v0p / v0v1v2;
-				float b3 = v0v1p / v0v1v2;
-
-				// Rational linear interpolation.
-				// https://www.scratchapixel.com/lessons/3d-basic-rendering/rasterization-practical-implementation/visibility-problem-depth-buffer-depth-interpolation
-				// Foundations of 3D Computer Graphics, Ch 13
-				// Remember that we store the z-value inside of our w
-				float wn_reciprocal = (b1 * (1.0f / coords[0].w)) + (b2 * (1.0f / coords[1].w)) + (b3 * (1.0f / coords[2].w));
-				float wn = (1.0f / wn_reciprocal);
-				vec4 barycentric(b1, b2, b3, wn);
-				uint32_t color;
-				bool discard = shader.fragment(barycentric, color);
-
-				if (!discard && wn < z_buffer[i + (j * frame.w)])
-				{
-					z_buffer[i + (j * frame.w)] = wn;
-					frame.set_pixel(i, j, color);
-				}
-			}
-		}
-	}
-}
-
-void Renderer::draw_wireframe_triangle(std::vector<vec4> coords)
-{
-    draw_line(coords[0].x, coords[0].y, coords[1].x, coords[1].y);
-    draw_line(coords[1].x, coords[1].y, coords[2].x, coords[2].y);
-    draw_line(coords[2].x, coords[2].y, coords[0].x, coords[0].y);
-}
-
-void Renderer::draw_line(int x0, int y0, int x1, int y1)
-{
-    int x = x0;
-    int y = y0;
-    int dx = std::abs(x1 - x0);
-    int dy = std::abs(y1 - y0);
-    bool steep = false;
-
-    if (dy > dx)
-    {
-        std::swap(x0, y0);
-        std::swap(x1, y1);
-        std::swap(x, y);
-        std::swap(dx, dy);
-        steep = true;
-    }
-
-    int P = 2*dy - dx;
-
-    bool decrement_x = (x0 > x1);
-    bool decrement_y = (y0 > y1);
-
-    while ((decrement_x) ? x >= x1 : x <= x1)
-    {
-        if (steep)
-        {
-            frame.set_pixel(y, x, 0xffff0000);
-        } else
-        {
-            frame.set_pixel(x, y, 0xffff0000); }
-        if (P < 0)
-        {
-            P = P + 2*dy;
-        } else
-        {
-            P = P + 2*dy - 2*dx;
-            if (decrement_y)
-            {
-                --y;
-            } else
-            {
-                ++y;
-            }
-        }
-        
-        if (decrement_x)
-        {
-            --x;
-        } else
-        {
-            ++x;
-        }
-    }
-}
-
-void Renderer::setup_zbuffer()
-{
-	z_buffer = new float[frame.w * frame.h];
-	for (int i = 0; i < frame.w * frame.h; i++)
-	{
-		z_buffer[i] = std::numeric_limits<float>::max();
-	}
+#include "renderer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <type_traits>
+#include <utility>
+#include "utils.h"
+#include "graphics.h"
+#include "vertex.h"
+#include "shaders/gouraud_shader.h"
+#include "shaders/phong_shader.h"
+
+Renderer::Renderer(World& w, Frame& f, Shader& s) :
+    world(w), frame(f), shader(s)
+{
+    set_pipeline_depth(1);
+}
+
+Renderer::~Renderer()
+{
+    drain_pipeline();
+}
+
+void Renderer::set_simd_level(SimdLevel level)
+{
+    simd_level = level;
+}
+
+SimdLevel Renderer::get_simd_level() const
+{
+    return simd_level;
+}
+
+void Renderer::set_shading_mode(ShadingMode mode)
+{
+    shading_mode = mode;
+}
+
+ShadingMode Renderer::get_shading_mode() const
+{
+    return shading_mode;
+}
+
+void Renderer::set_occlusion_culling(bool enabled)
+{
+    occlusion_culling = enabled;
+}
+
+bool Renderer::get_occlusion_culling() const
+{
+    return occlusion_culling;
+}
+
+void Renderer::set_lod_threshold(float pixels)
+{
+    lod_threshold = pixels;
+}
+
+float Renderer::get_lod_threshold() const
+{
+    return lod_threshold;
+}
+
+const RenderStats& Renderer::get_stats() const
+{
+    return stats;
+}
+
+void Renderer::set_pipeline_depth(int frames)
+{
+    reset_pipeline(std::min(std::max(frames, 1), MAX_PIPELINE_DEPTH));
+}
+
+int Renderer::get_pipeline_depth() const
+{
+    return pipeline_depth;
+}
+
+// Finishes the frames in flight and drops them, then splits the window into tiles and makes new frames for the given
+// depth, at the window's current size.
+void Renderer::reset_pipeline(int depth)
+{
+    drain_pipeline();
+    pipeline_depth = depth;
+    frames_recorded = 0;
+
+    frame_w = frame.w;
+    frame_h = frame.h;
+    tiles_x = (frame.w + TILE_SIZE - 1) / TILE_SIZE;
+    tiles_y = (frame.h + TILE_SIZE - 1) / TILE_SIZE;
+
+    frames_in_flight.clear();
+    for (int i = 0; i < pipeline_depth; i++)
+    {
+        frames_in_flight.push_back(std::make_unique<FrameInFlight>());
+        FrameInFlight& frame_in_flight = *frames_in_flight.back();
+        if (pipeline_depth == 1)
+        {
+            frame_in_flight.target = &frame;
+        } else
+        {
+            // Each frame in flight draws into a target of its own, the size and format of the window.
+            frame_in_flight.own_target = std::make_unique<Frame>(frame.w, frame.h, frame.pixel_format);
+            frame_in_flight.target = frame_in_flight.own_target.get();
+        }
+    }
+}
+
+// Frame n is recorded by the nth call. Its geometry then runs while frame n - 1 is rasterized, and in a pipeline three
+// frames deep, that runs while the caller shows frame n - 2. A stage only waits for the stage before it of the same frame,
+// and for the same stage of the frame before, so the workers always have the next frame's work to pick up.
+Frame* Renderer::render()
+{
+    // The frames in flight were binned into tiles of the window at its old size, and draw into targets of that size.
+    if (frame.w != frame_w || frame.h != frame_h)
+    {
+        reset_pipeline(pipeline_depth);
+    }
+
+    uint64_t number = frames_recorded++;
+    FrameInFlight& current = *frames_in_flight[number % pipeline_depth];
+    record_frame(current);
+
+    if (pipeline_depth == 1)
+    {
+        process_geometry(current);
+        rasterize_frame(current);
+        return finish_frame(current);
+    }
+
+    thread_pool.spawn(current.geometry_jobs, [this, &current] { process_geometry(current); });
+    if (number < 1) return nullptr;
+
+    FrameInFlight& previous = *frames_in_flight[(number - 1) % pipeline_depth];
+    thread_pool.wait(previous.geometry_jobs);
+    if (pipeline_depth == 2)
+    {
+        rasterize_frame(previous);
+        return finish_frame(previous);
+    }
+
+    // The frame before that has been rasterizing since the last call, and the two share the depth buffer.
+    FrameInFlight* oldest = number >= 2 ? frames_in_flight[(number - 2) % pipeline_depth].get() : nullptr;
+    if (oldest != nullptr)
+    {
+        thread_pool.wait(oldest->raster_jobs);
+    }
+    thread_pool.spawn(previous.raster_jobs, [this, &previous] { rasterize_frame(previous); });
+    return oldest != nullptr ? finish_frame(*oldest) : nullptr;
+}
+
+// Waits until no frame has any work left running, and leaves the frames where they are.
+void Renderer::drain_pipeline()
+{
+    for (std::unique_ptr<FrameInFlight>& frame_in_flight : frames_in_flight)
+    {
+        thread_pool.wait(frame_in_flight->geometry_jobs);
+        thread_pool.wait(frame_in_flight->raster_jobs);
+    }
+}
+
+// Copies the camera, the light and the renderer's settings into the frame's packet, then culls the objects and sets up
+// a draw for each one that is left, with its transform, and the geometry batches that will draw them. This is the only
+// stage that looks at the world, and render() waits for it, so the world is free to change between calls to render()
+// however many frames are still in flight. The bounding spheres are culled as jobs, but the BVH query, the occlusion
+// buffer and setting up the draws run on the calling thread: they stay cheap next to the frame's other stages, since
+// the BVH only walks what is in view, and running them in order keeps the draws in submission order.
+void Renderer::record_frame(FrameInFlight& frame_in_flight)
+{
+    FramePacket& packet = frame_in_flight.packet;
+    packet.eye = world.get_eye();
+    packet.look_at = world.get_look_at_pt();
+    packet.light = world.get_light();
+    packet.shading_mode = shading_mode;
+    packet.simd_level = simd_level;
+    packet.draws.clear();
+    packet.recorded = std::chrono::steady_clock::now();
+    frame_in_flight.batch_count = 0;
+    RenderStats& frame_stats = frame_in_flight.stats;
+    frame_stats = RenderStats();
+    frame_stats.pipeline_depth = pipeline_depth;
+
+    // The camera is the same for every object, so the view and projection are only combined once.
+    mat4 projection = perspective();
+    mat4 view_projection = projection * lookAt(packet.eye, packet.look_at);
+    lod_scale = 0.5f * std::max(frame.w * projection(0, 0), frame.h * projection(1, 1));
+
+    FrustumPlanes frustum = frustum_planes(view_projection);
+    cull_objects(packet, frustum);
+    frame_stats.objects_submitted += world.getObjects().size();
+    frame_stats.objects_frustum_culled += world.getObjects().size() - visible_objects.size();
+    cull_occluded_objects(packet, frustum, view_projection, frame_stats);
+
+    // What is the same for every draw in the frame.
+    DrawUniforms frame_uniforms;
+    frame_uniforms.viewport = viewport(frame);
+    frame_uniforms.light_direction = packet.light.normalize();
+
+    for (Object* object : visible_objects)
+    {
+        std::shared_ptr<Mesh>& mesh = object->getMesh();
+        frame_uniforms.texture = mesh->getTexture();
+        packet.draws.push_back(setup_draw(packet, frame_uniforms, *object->getMat(), view_projection));
+        add_draw(frame_in_flight, *mesh, (int) packet.draws.size() - 1, select_lod(packet, *mesh, object->getWorldBoundingSphere()));
+    }
+
+    // The copies of an instanced object share the mesh, its texture and everything else that doesn't depend on
+    // their matrices, and are drawn back to back, so that the mesh's data stays in cache from one to the next.
+    for (InstancedObject* instances : world.getInstances())
+    {
+        std::shared_ptr<Mesh>& mesh = instances->getMesh();
+        frame_uniforms.texture = mesh->getTexture();
+        cull_instances(packet, *instances, frustum, frame_stats);
+
+        const std::vector<mat4>& transforms = instances->getTransforms();
+        for (uint32_t i : visible_instances)
+        {
+            packet.draws.push_back(setup_draw(packet, frame_uniforms, transforms[i], view_projection));
+            packet.draws.back().instance_parameters = instances->getInstanceParameters(i);
+            add_draw(frame_in_flight, *mesh, (int) packet.draws.size() - 1, select_lod(packet, *mesh, instances->getInstanceBoundingSphere(i)));
+        }
+    }
+}
+
+// Each batch runs the vertex stage and bins its triangles as a job of its own.
+void Renderer::process_geometry(FrameInFlight& frame_in_flight)
+{
+    thread_pool.parallel_for((int) frame_in_flight.batch_count, [this, &frame_in_flight](int b) {
+        process_batch(frame_in_flight.packet, frame_in_flight.batches[b]);
+    });
+}
+
+// The tiles are rasterized as jobs too, once all of the frame's batches are done, each going through the batches in order,
+// so that every tile still sees the triangles of all objects in the order they were submitted.
+void Renderer::rasterize_frame(FrameInFlight& frame_in_flight)
+{
+    depth_buffer.resize(frame.w, frame.h);
+    if (frame_in_flight.packet.shading_mode == ShadingMode::Deferred)
+    {
+        visibility.resize(frame.w * frame.h);
+    }
+    tile_stats.assign(tiles_x * tiles_y, RenderStats());
+
+    rasterizing = &frame_in_flight;
+    TileFunction rasterize = select_tile_function();
+    thread_pool.parallel_for(tiles_x * tiles_y, [this, rasterize](int tile) { (this->*rasterize)(tile); });
+    rasterizing = nullptr;
+
+    for (size_t b = 0; b < frame_in_flight.batch_count; b++)
+    {
+        frame_in_flight.stats += frame_in_flight.batches[b].stats;
+    }
+    for (const RenderStats& s : tile_stats)
+    {
+        frame_in_flight.stats += s;
+    }
+}
+
+// Hands a drawn frame back to the caller of render(), with its counters.
+Frame* Renderer::finish_frame(FrameInFlight& frame_in_flight)
+{
+    frame_in_flight.stats.latency_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frame_in_flight.packet.recorded).count();
+    stats = frame_in_flight.stats;
+    return frame_in_flight.target;
+}
+
+// Collects in visible_objects the objects that may be seen at all, before any of them is set up for drawing.
+// The world's BVH only reaches the objects whose (slightly grown) boxes aren't outside the view frustum, so the cost
+// follows what is in view rather than the size of the world, and hands them over roughly nearest first, which
+// suits the depth test. Their tighter world-space bounding spheres are then tested against the frustum too.
+// If occluded is given, the BVH also skips the nodes it says are hidden.
+void Renderer::cull_objects(const FramePacket& packet, const FrustumPlanes& frustum, const std::function<bool(const AABB&)>& occluded)
+{
+    std::vector<Object*>& objects = candidate_objects;
+    objects.clear();
+    world.queryObjects(frustum, packet.eye, objects, occluded);
+
+    size_t count = objects.size();
+    cull_bounding_spheres(frustum, count, [&objects](size_t o) { return objects[o]->getWorldBoundingSphere(); });
+
+    visible_objects.clear();
+    for (size_t o = 0; o < count; o++)
+    {
+        if (object_visible[o]) visible_objects.push_back(objects[o]);
+    }
+}
+
+// Sets object_visible[i] for the bounding spheres sphere(i) of the first count objects, or copies, to whether they aren't
+// outside the frustum, and returns how many are. Every CULL_BATCH_OBJECTS of them are gathered into the arrays and
+// culled as a job of their own, and the caller waits for all of them.
+template <typename SphereFunction>
+size_t Renderer::cull_bounding_spheres(const FrustumPlanes& frustum, size_t count, const SphereFunction& sphere)
+{
+    object_x.resize(count);
+    object_y.resize(count);
+    object_z.resize(count);
+    object_radius.resize(count);
+    object_visible.resize(count);
+
+    std::atomic<size_t> culled{0};
+    int batches = (int) ((count + CULL_BATCH_OBJECTS - 1) / CULL_BATCH_OBJECTS);
+    thread_pool.parallel_for(batches, [this, &frustum, count, &sphere, &culled](int batch) {
+        size_t begin = (size_t) batch * CULL_BATCH_OBJECTS;
+        size_t end = std::min(begin + CULL_BATCH_OBJECTS, count);
+        for (size_t i = begin; i < end; i++)
+        {
+            BoundingSphere s = sphere(i);
+            object_x[i] = s.center.x;
+            object_y[i] = s.center.y;
+            object_z[i] = s.center.z;
+            object_radius[i] = s.radius;
+        }
+        culled.fetch_add(cull_spheres(frustum, object_x.data() + begin, object_y.data() + begin, object_z.data() + begin,
+                                      object_radius.data() + begin, end - begin, object_visible.data() + begin),
+                         std::memory_order_relaxed);
+    });
+    return culled.load(std::memory_order_relaxed);
+}
+
+// Draws the visible occluders into the occlusion buffer, nearest first, and if there were any, culls the objects
+// again, now also skipping every BVH node whose box is hidden behind them. An occluder can't hide itself, since the
+// depths it leaves in the buffer are never closer than its own box.
+void Renderer::cull_occluded_objects(const FramePacket& packet, const FrustumPlanes& frustum, const mat4& view_projection, RenderStats& frame_stats)
+{
+    occlusion_active = false;
+    if (!occlusion_culling) return;
+
+    auto start = std::chrono::steady_clock::now();
+    occlusion_buffer.resize(OcclusionBuffer::DEFAULT_WIDTH, OcclusionBuffer::DEFAULT_HEIGHT);
+    occlusion_buffer.clear(view_projection);
+    for (Object* object : visible_objects)
+    {
+        if (!object->isOccluder()) continue;
+        frame_stats.occluder_triangles += occlusion_buffer.draw_occluder(*object->getMesh(), *object->getMat());
+        occlusion_active = true;
+    }
+
+    if (occlusion_active)
+    {
+        size_t unoccluded = visible_objects.size();
+        cull_objects(packet, frustum, [this](const AABB& box) { return occlusion_buffer.occluded(box); });
+        frame_stats.objects_occlusion_culled += unoccluded - visible_objects.size();
+    }
+    frame_stats.occlusion_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Collects in visible_instances the copies whose world-space bounding spheres aren't outside the view frustum,
+// nearest first, the way the BVH hands objects over.
+void Renderer::cull_instances(const FramePacket& packet, const InstancedObject& instances, const FrustumPlanes& frustum, RenderStats& frame_stats)
+{
+    size_t count = instances.size();
+    size_t culled = cull_bounding_spheres(frustum, count, [&instances](size_t i) { return instances.getInstanceBoundingSphere(i); });
+    frame_stats.instances_submitted += count;
+    frame_stats.instances_frustum_culled += culled;
+
+    if (occlusion_active)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < count; i++)
+        {
+            if (!object_visible[i] || !occlusion_buffer.occluded(instances.getInstanceBounds(i))) continue;
+            object_visible[i] = 0;
+            frame_stats.instances_occlusion_culled++;
+        }
+        frame_stats.occlusion_ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    visible_instances.clear();
+    instance_distances.resize(count);
+    const vec3& eye = packet.eye;
+    for (size_t i = 0; i < count; i++)
+    {
+        if (!object_visible[i]) continue;
+        vec3 offset = vec3(object_x[i], object_y[i], object_z[i]) - eye;
+        instance_distances[i] = dot(offset, offset);
+        visible_instances.push_back((uint32_t) i);
+    }
+    std::sort(visible_instances.begin(), visible_instances.end(),
+              [this](uint32_t a, uint32_t b) { return instance_distances[a] < instance_distances[b]; });
+}
+
+// Computes everything that depends on the model matrix, so that the vertex and fragment stages don't have to.
+// The rest comes from frame_uniforms.
+DrawUniforms Renderer::setup_draw(const FramePacket& packet, const DrawUniforms& frame_uniforms, const mat4& model, const mat4& view_projection) const
+{
+    DrawUniforms uniforms = frame_uniforms;
+    uniforms.model = model;
+    uniforms.mvp = view_projection * model;
+    uniforms.normal_matrix = normalMatrix(model);
+
+    mat4 inverse_model = inverse(model);
+    const vec3& eye = packet.eye;
+    const vec3& light = packet.light;
+    uniforms.eye = vec3(inverse_model * vec4(eye.x, eye.y, eye.z, 1));
+    uniforms.light = vec3(inverse_model * vec4(light.x, light.y, light.z, 1));
+    return uniforms;
+}
+
+// The coarsest level of detail whose error, scaled like the mesh is into the world and seen at the nearest point of
+// its bounding sphere, spans at most lod_threshold pixels. Objects that reach around the eye are drawn in full.
+size_t Renderer::select_lod(const FramePacket& packet, const Mesh& mesh, const BoundingSphere& world_sphere) const
+{
+    if (lod_threshold <= 0 || mesh.getLodCount() == 1) return 0;
+
+    float distance = (world_sphere.center - packet.eye).length() - world_sphere.radius;
+    if (!(distance > 0)) return 0;
+
+    float mesh_radius = mesh.getBoundingSphere().radius;
+    float scale = mesh_radius > 0 ? world_sphere.radius / mesh_radius : 1;
+    float max_error = lod_threshold * distance / (lod_scale * scale);
+
+    size_t level = 0;
+    while (level + 1 < mesh.getLodCount() && mesh.getLod(level + 1).error <= max_error) level++;
+    return level;
+}
+
+// Queues up the given level of detail of the mesh to be drawn with the uniforms of the given draw, filling the current
+// batch and opening new ones as needed. Levels with meshlets are split between batches at meshlet boundaries, the others
+// at any triangle, so that even a single large mesh is spread across several jobs.
+void Renderer::add_draw(FrameInFlight& frame_in_flight, const Mesh& mesh, int draw, size_t level)
+{
+    const MeshLod& lod = mesh.getLod(level);
+    size_t triangle_count = lod.indices.size() / 3;
+    frame_in_flight.stats.triangles_submitted += triangle_count;
+    if (level > 0)
+    {
+        frame_in_flight.stats.draws_simplified++;
+        frame_in_flight.stats.triangles_lod_reduced += mesh.getTriangleCount() - triangle_count;
+    }
+
+    ArrayView<Meshlet> meshlets = lod.meshlets;
+    size_t next_meshlet = 0;
+    size_t next_triangle = 0;
+    while (next_triangle < triangle_count)
+    {
+        std::vector<GeometryBatch>& batches = frame_in_flight.batches;
+        size_t batch_count = frame_in_flight.batch_count;
+        GeometryBatch& batch = batch_count > 0 && batches[batch_count - 1].triangle_count < GEOMETRY_BATCH_TRIANGLES
+                                   ? batches[batch_count - 1] : open_batch(frame_in_flight);
+        size_t room = GEOMETRY_BATCH_TRIANGLES - batch.triangle_count;
+
+        DrawPiece piece;
+        piece.draw = draw;
+        piece.lod = &lod;
+        piece.mesh = &mesh;
+        piece.triangle_begin = next_triangle;
+        if (meshlets.empty())
+        {
+            next_triangle = std::min(triangle_count, next_triangle + room);
+        } else
+        {
+            // At least one meshlet, even if it overfills the batch a little.
+            piece.meshlet_begin = next_meshlet;
+            do
+            {
+                next_triangle += meshlets[next_meshlet].triangle_count;
+                next_meshlet++;
+            } while (next_meshlet < meshlets.size() && next_triangle - piece.triangle_begin + meshlets[next_meshlet].triangle_count <= room);
+            piece.meshlet_end = next_meshlet;
+        }
+        piece.triangle_end = next_triangle;
+
+        batch.pieces.push_back(piece);
+        batch.triangle_count += piece.triangle_end - piece.triangle_begin;
+    }
+}
+
+Renderer::GeometryBatch& Renderer::open_batch(FrameInFlight& frame_in_flight)
+{
+    std::vector<GeometryBatch>& batches = frame_in_flight.batches;
+    if (frame_in_flight.batch_count == batches.size())
+    {
+        batches.emplace_back();
+    }
+    GeometryBatch& batch = batches[frame_in_flight.batch_count++];
+    batch.pieces.clear();
+    batch.triangle_count = 0;
+    return batch;
+}
+
+// Runs on a worker. Everything it writes belongs to the batch, and all it reads is the frame's packet and the meshes.
+void Renderer::process_batch(const FramePacket& packet, GeometryBatch& batch)
+{
+    batch.triangles.clear();
+    batch.stats = RenderStats();
+    for (const DrawPiece& piece : batch.pieces)
+    {
+        draw_piece(packet, batch, piece);
+    }
+    bin_triangles(batch);
+}
+
+// Runs the piece through the vertex stage with the uniforms of its draw, and submits its triangles under it.
+// Whole meshlets are culled first, then every unique vertex of the rest is shaded and projected once, and the triangles
+// are assembled from the results.
+void Renderer::draw_piece(const FramePacket& packet, GeometryBatch& batch, const DrawPiece& piece)
+{
+    const DrawUniforms& uniforms = packet.draws[piece.draw];
+    cull_meshlets(batch, piece, uniforms);
+    shade_vertices(batch, *piece.mesh, uniforms);
+    project_vertices(batch, uniforms);
+
+    ArrayView<uint32_t> indices = piece.lod->indices;
+    uint32_t base = (uint32_t) batch.vertex_begin;
+    for (const std::pair<size_t, size_t>& range : batch.visible_triangles)
+    {
+        for (size_t i = range.first * 3; i < range.second * 3; i += 3)
+        {
+            const uint32_t corners[3] = { indices[i] - base, indices[i + 1] - base, indices[i + 2] - base };
+            clip_and_submit(packet, batch, corners, piece.draw);
+        }
+    }
+}
+
+// Decides which of the piece's triangles are drawn, as ranges in visible_triangles, and marks the vertices they use in
+// vertex_visible, which only spans the vertices between the lowest and highest of those. Meshlets entirely outside the
+// frustum or facing away from the eye are skipped before any of their vertices are transformed. A piece of a level without
+// meshlets is drawn whole.
+void Renderer::cull_meshlets(GeometryBatch& batch, const DrawPiece& piece, const DrawUniforms& uniforms)
+{
+    ArrayView<uint32_t> indices = piece.lod->indices;
+    ArrayView<Meshlet> meshlets = piece.lod->meshlets;
+    ArrayView<uint32_t> meshlet_vertices = piece.lod->meshlet_vertices;
+    batch.visible_triangles.clear();
+
+    uint32_t lowest = UINT32_MAX;
+    uint32_t highest = 0;
+    if (meshlets.empty())
+    {
+        for (size_t i = piece.triangle_begin * 3; i < piece.triangle_end * 3; i++)
+        {
+            lowest = std::min(lowest, indices[i]);
+            highest = std::max(highest, indices[i]);
+        }
+        batch.vertex_begin = lowest;
+        batch.vertex_visible.assign(highest + 1 - lowest, 0);
+        for (size_t i = piece.triangle_begin * 3; i < piece.triangle_end * 3; i++)
+        {
+            batch.vertex_visible[indices[i] - lowest] = 1;
+        }
+        batch.visible_triangles.emplace_back(piece.triangle_begin, piece.triangle_end);
+        return;
+    }
+
+    FrustumPlanes frustum = frustum_planes(uniforms.mvp);
+    batch.visible_meshlets.clear();
+    for (size_t m = piece.meshlet_begin; m < piece.meshlet_end; m++)
+    {
+        const Meshlet& meshlet = meshlets[m];
+        batch.stats.meshlets_submitted++;
+        if (sphere_outside_frustum(frustum, meshlet.center, meshlet.radius))
+        {
+            batch.stats.meshlets_frustum_culled++;
+            batch.stats.triangles_meshlet_culled += meshlet.triangle_count;
+            continue;
+        }
+        if (meshlet.backfacing(uniforms.eye))
+        {
+            batch.stats.meshlets_backface_culled++;
+            batch.stats.triangles_meshlet_culled += meshlet.triangle_count;
+            continue;
+        }
+
+        // Meshlets are consecutive in the index order, so neighbouring visible ones make up one range.
+        size_t begin = meshlet.triangle_offset;
+        size_t end = begin + meshlet.triangle_count;
+        if (!batch.visible_triangles.empty() && batch.visible_triangles.back().second == begin)
+        {
+            batch.visible_triangles.back().second = end;
+        } else
+        {
+            batch.visible_triangles.emplace_back(begin, end);
+        }
+
+        batch.visible_meshlets.push_back((uint32_t) m);
+        for (uint32_t i = meshlet.vertex_offset; i < meshlet.vertex_offset + meshlet.vertex_count; i++)
+        {
+            lowest = std::min(lowest, meshlet_vertices[i]);
+            highest = std::max(highest, meshlet_vertices[i]);
+        }
+    }
+
+    if (batch.visible_meshlets.empty())
+    {
+        batch.vertex_begin = 0;
+        batch.vertex_visible.clear();
+        return;
+    }
+
+    batch.vertex_begin = lowest;
+    batch.vertex_visible.assign(highest + 1 - lowest, 0);
+    for (uint32_t m : batch.visible_meshlets)
+    {
+        const Meshlet& meshlet = meshlets[m];
+        for (uint32_t i = meshlet.vertex_offset; i < meshlet.vertex_offset + meshlet.vertex_count; i++)
+        {
+            batch.vertex_visible[meshlet_vertices[i] - lowest] = 1;
+        }
+    }
+}
+
+// Runs the vertex stage over the visible vertices, through the shader's batched version when it has one.
+// Optimized meshes number their vertices in the order the triangles use them, so the visible ones mostly come in long runs,
+// which are each handed to the batched version in one go.
+void Renderer::shade_vertices(GeometryBatch& batch, const Mesh& mesh, const DrawUniforms& uniforms)
+{
+    size_t count = batch.vertex_visible.size();
+    batch.clip_positions.resize(count);
+    batch.clip_varyings.resize(count);
+    const VertexStreams& streams = mesh.getVertexStreams();
+    size_t base = batch.vertex_begin;
+
+    size_t begin = 0;
+    while (begin < count)
+    {
+        while (begin < count && !batch.vertex_visible[begin]) begin++;
+        size_t end = begin;
+        while (end < count && batch.vertex_visible[end]) end++;
+        if (begin == end) break;
+        batch.stats.vertices_shaded += end - begin;
+
+        if (!shader.vertex_batch(uniforms, streams.slice(base + begin, end - begin), &batch.clip_positions[begin], &batch.clip_varyings[begin]))
+        {
+            for (size_t v = begin; v < end; v++)
+            {
+                batch.clip_positions[v] = shader.vertex(uniforms, mesh.getVertex(base + v), batch.clip_varyings[v]);
+            }
+        }
+        begin = end;
+    }
+}
+
+// Computes each visible vertex's outcode, and projects the ones in front of the eye into screen space.
+// Triangles that need no clipping then use these directly instead of projecting their corners one triangle at a time.
+void Renderer::project_vertices(GeometryBatch& batch, const DrawUniforms& uniforms)
+{
+    size_t count = batch.vertex_visible.size();
+    batch.outcodes.resize(count);
+    batch.screen_vertices.resize(count);
+
+    for (size_t v = 0; v < count; v++)
+    {
+        if (!batch.vertex_visible[v]) continue;
+        batch.outcodes[v] = compute_outcode(batch.clip_positions[v]);
+        if (batch.clip_positions[v].w > 0)
+        {
+            project(uniforms, batch.clip_positions[v], batch.clip_varyings[v], batch.screen_vertices[v]);
+        }
+    }
+}
+
+// Turns the triangle into screen-space triangles for binning, clipping it in homogeneous space first if it has to be.
+void Renderer::clip_and_submit(const FramePacket& packet, GeometryBatch& batch, const uint32_t (&corners)[3], int draw)
+{
+    int code0 = batch.outcodes[corners[0]];
+    int code1 = batch.outcodes[corners[1]];
+    int code2 = batch.outcodes[corners[2]];
+
+    switch (classify_triangle(code0, code1, code2))
+    {
+    case ClipResult::Culled:
+        batch.stats.triangles_culled++;
+        return;
+    case ClipResult::Inside:
+        if (outside_screen(code0) || outside_screen(code1) || outside_screen(code2))
+        {
+            batch.stats.triangles_guard_band++;
+        }
+        submit_triangle(batch, batch.screen_vertices[corners[0]], batch.screen_vertices[corners[1]], batch.screen_vertices[corners[2]], draw);
+        return;
+    case ClipResult::Clipped:
+        break;
+    }
+
+    ClipVertex triangle[3];
+    for (int k = 0; k < 3; k++)
+    {
+        triangle[k].position = batch.clip_positions[corners[k]];
+        triangle[k].varyings = batch.clip_varyings[corners[k]];
+    }
+
+    ClipVertex polygon[MAX_CLIPPED_VERTICES];
+    int num_vertices = 0;
+    clip_triangle(triangle, polygon, num_vertices);
+    batch.stats.triangles_clipped++;
+    batch.stats.clipped_output += std::max(num_vertices - 2, 0);
+
+    ScreenVertex screen[MAX_CLIPPED_VERTICES];
+    for (int i = 0; i < num_vertices; i++)
+    {
+        project(packet.draws[draw], polygon[i].position, polygon[i].varyings, screen[i]);
+    }
+
+    // The clipped polygon is convex, so it can be drawn as a fan around its first vertex.
+    for (int i = 1; i + 1 < num_vertices; i++)
+    {
+        submit_triangle(batch, screen[0], screen[i], screen[i + 1], draw);
+    }
+}
+
+void Renderer::submit_triangle(GeometryBatch& batch, const ScreenVertex& a, const ScreenVertex& b, const ScreenVertex& c, int draw)
+{
+    Triangle triangle;
+    triangle.draw = draw;
+    triangle.coords[0] = a.position;
+    triangle.coords[1] = b.position;
+    triangle.coords[2] = c.position;
+    triangle.varyings[0] = a.varyings;
+    triangle.varyings[1] = b.varyings;
+    triangle.varyings[2] = c.varyings;
+
+    // Back-facing, degenerate and off-screen triangles are rejected during setup.
+    if (triangle.setup.setup(triangle.coords, frame.w, frame.h)) { batch.triangles.push_back(triangle); }
+}
+
+// The perspective divide and viewport transform, taking a vertex from clip space into screen space.
+void Renderer::project(const DrawUniforms& uniforms, const vec4& clip, const Varyings& varyings, ScreenVertex& out) const
+{
+    float w_reciprocal = 1.0f / clip.w;
+
+    out.position = uniforms.viewport * vec4(clip.x * w_reciprocal, clip.y * w_reciprocal, clip.z * w_reciprocal, 1.0f);
+    out.position.w = clip.w; // Keep wn (aka -z) for perspective-correct linear interpolation.
+
+    // https://www.scratchapixel.com/lessons/3d-basic-rendering/rasterization-practical-implementation/perspective-correct-interpolation-vertex-attributes
+    // we must divide vertex attributes by z first before linearly interpolating
+    for (int k = 0; k < Varyings::MAX_VARYINGS; k++)
+    {
+        out.varyings.v[k] = varyings.v[k] * w_reciprocal;
+    }
+}
+
+// Sort the batch's triangles into every tile that their bounding box touches.
+// Each bin keeps the submission order, so overlapping triangles resolve exactly like they would on a single thread.
+void Renderer::bin_triangles(GeometryBatch& batch)
+{
+    batch.tile_bins.resize(tiles_x * tiles_y);
+    for (std::vector<int>& bin : batch.tile_bins)
+    {
+        bin.clear();
+    }
+
+    for (int t = 0; t < (int) batch.triangles.size(); t++)
+    {
+        const TriangleSetup& setup = batch.triangles[t].setup;
+
+        for (int ty = setup.min_y / TILE_SIZE; ty <= setup.max_y / TILE_SIZE; ty++)
+        {
+            for (int tx = setup.min_x / TILE_SIZE; tx <= setup.max_x / TILE_SIZE; tx++)
+            {
+                batch.tile_bins[tx + (ty * tiles_x)].push_back(t);
+            }
+        }
+    }
+}
+
+// Picks the instantiation of the tile rasterizer for the shader's concrete type, once per frame.
+// The built-in shaders are final, so in their instantiations fragment() is a direct call that inlines into the pixel loops.
+// Any other shader goes through the generic instantiation, which calls fragment() virtually.
+Renderer::TileFunction Renderer::select_tile_function() const
+{
+    if (dynamic_cast<const PhongShader*>(&shader) != nullptr) return &Renderer::rasterize_tile<PhongShader>;
+    if (dynamic_cast<const GouraudShader*>(&shader) != nullptr) return &Renderer::rasterize_tile<GouraudShader>;
+    return &Renderer::rasterize_tile<Shader>;
+}
+
+// Tiles never overlap, so each one owns its slice of the z-buffer and the frame and needs no locking.
+template <typename ShaderType>
+void Renderer::rasterize_tile(int tile)
+{
+    int min_x = (tile % tiles_x) * TILE_SIZE;
+    int min_y = (tile / tiles_x) * TILE_SIZE;
+    int max_x = std::min(min_x + TILE_SIZE, frame.w) - 1;
+    int max_y = std::min(min_y + TILE_SIZE, frame.h) - 1;
+    Frame& target = *rasterizing->target;
+
+    // Every tile clears its own part of the frame and the depth buffer right before using it, in parallel and while
+    // it's in cache.
+    for (int y = min_y; y <= max_y; y++)
+    {
+        uint32_t* color_row = target.buffer + (y * frame.w);
+        std::fill(color_row + min_x, color_row + max_x + 1, BACKGROUND_COLOR);
+    }
+    depth_buffer.clear(min_x, min_y, max_x, max_y);
+
+    if (rasterizing->packet.shading_mode == ShadingMode::Deferred)
+    {
+        for (int y = min_y; y <= max_y; y++)
+        {
+            const Triangle** visibility_row = visibility.data() + (y * frame.w);
+            std::fill(visibility_row + min_x, visibility_row + max_x + 1, nullptr);
+        }
+        draw_tile_triangles<VisibilityPass>(tile, min_x, min_y, max_x, max_y);
+        resolve_tile<ShaderType>(min_x, min_y, max_x, max_y, tile_stats[tile]);
+    } else
+    {
+        draw_tile_triangles<ShaderType>(tile, min_x, min_y, max_x, max_y);
+    }
+}
+
+// The batches are gone through in order, so the triangles come in the order they were submitted.
+template <typename ShaderType>
+void Renderer::draw_tile_triangles(int tile, int min_x, int min_y, int max_x, int max_y)
+{
+    const FrameInFlight& frame_in_flight = *rasterizing;
+
+    // The farthest depth anywhere in the tile. A triangle that is nearer nowhere than this is hidden in the whole tile.
+    float tile_max_depth = DepthBuffer::CLEAR_DEPTH;
+    for (size_t b = 0; b < frame_in_flight.batch_count; b++)
+    {
+        const GeometryBatch& batch = frame_in_flight.batches[b];
+        for (int t : batch.tile_bins[tile])
+        {
+            const Triangle& triangle = batch.triangles[t];
+            if (triangle.setup.min_depth >= tile_max_depth)
+            {
+                tile_stats[tile].triangles_hiz_rejected++;
+                continue;
+            }
+
+            if (draw_triangle_blocks<ShaderType>(triangle, min_x, min_y, max_x, max_y, tile_stats[tile]))
+            {
+                tile_max_depth = depth_buffer.max_depth(min_x, min_y, max_x, max_y);
+            }
+        }
+    }
+}
+
+// Rasterizes the part of the triangle that lies inside [min_x, max_x] x [min_y, max_y]. Coverage and depth are tested
+// for 8 pixels at a time by rasterize_row, at the frame's SIMD level, and only the pixels left in each block's mask
+// reach the fragment shader. The area is first walked in coarse blocks, at every level including Scalar: blocks outside the triangle are skipped entirely,
+// and blocks inside it skip the per-pixel edge tests. Only blocks straddling an edge are tested per pixel.
+// Blocks whose farthest stored depth is nearer than the whole triangle are skipped as well (Hi-Z).
+// Returns true if the farthest depth of any block was lowered.
+template <typename ShaderType>
+bool Renderer::draw_triangle_blocks(const Triangle& triangle, int min_x, int min_y, int max_x, int max_y, RenderStats& tile_stats)
+{
+	const TriangleSetup& setup = triangle.setup;
+
+	min_x = std::max(min_x, setup.min_x);
+	max_x = std::min(max_x, setup.max_x);
+	min_y = std::max(min_y, setup.min_y);
+	max_y = std::min(max_y, setup.max_y);
+	if (min_x > max_x || min_y > max_y) return false;
+
+	SimdLevel level = fits_simd_lanes(setup, min_x, min_y, max_x, max_y) ? rasterizing->packet.simd_level : SimdLevel::Scalar;
+
+	// Neighbouring coarse blocks with the same coverage are merged into one span per row.
+	struct Span
+	{
+		int min_x;
+		int max_x;
+		bool covered;
+	};
+	Span spans[TILE_SIZE / COARSE_BLOCK_SIZE];
+	PixelBlock blocks[(TILE_SIZE / PixelBlock::WIDTH) + 1];
+	bool updated = false;
+
+	// Tiles start on a multiple of the block size, so blocks stay aligned to the screen.
+	for (int block_y = min_y - (min_y % COARSE_BLOCK_SIZE); block_y <= max_y; block_y += COARSE_BLOCK_SIZE)
+	{
+		int num_spans = 0;
+		for (int block_x = min_x - (min_x % COARSE_BLOCK_SIZE); block_x <= max_x; block_x += COARSE_BLOCK_SIZE)
+		{
+			BlockCoverage coverage = classify_block(setup, block_x, block_y, COARSE_BLOCK_SIZE);
+			if (coverage == BlockCoverage::Outside)
+			{
+				tile_stats.blocks_rejected++;
+				continue;
+			}
+			if (setup.min_depth >= depth_buffer.block_max_depth(block_x, block_y))
+			{
+				tile_stats.blocks_hiz_rejected++;
+				continue;
+			}
+
+			bool covered = coverage == BlockCoverage::Inside;
+			if (covered)
+			{
+				tile_stats.blocks_accepted++;
+			} else
+			{
+				tile_stats.blocks_partial++;
+			}
+
+			int span_min_x = std::max(block_x, min_x);
+			int span_max_x = std::min(block_x + COARSE_BLOCK_SIZE - 1, max_x);
+			if (num_spans > 0 && spans[num_spans - 1].max_x + 1 == span_min_x && spans[num_spans - 1].covered == covered)
+			{
+				spans[num_spans - 1].max_x = span_max_x;
+			} else
+			{
+				spans[num_spans++] = { span_min_x, span_max_x, covered };
+			}
+		}
+
+		int rows_end = std::min(block_y + COARSE_BLOCK_SIZE - 1, max_y);
+		for (int j = std::max(block_y, min_y); j <= rows_end; j++)
+		{
+			const float* depth_row = depth_buffer.row(j);
+			for (int s = 0; s < num_spans; s++)
+			{
+				int depth_rejected = 0;
+				int num_blocks = rasterize_row(level, setup, j, spans[s].min_x, spans[s].max_x, spans[s].covered, depth_row, blocks, depth_rejected);
+				tile_stats.fragments_rejected_early += depth_rejected;
+				shade_blocks<ShaderType>(triangle, j, blocks, num_blocks, tile_stats);
+			}
+		}
+
+		// Only fully covered blocks are brought up to date, since they are the ones likely to have moved their farthest
+		// depth. The others keep their old value, which is still an upper bound.
+		for (int s = 0; s < num_spans; s++)
+		{
+			if (!spans[s].covered) continue;
+			for (int block_x = spans[s].min_x; block_x <= spans[s].max_x; block_x += COARSE_BLOCK_SIZE)
+			{
+				depth_buffer.update_block(block_x, block_y);
+				updated = true;
+			}
+		}
+	}
+	return updated;
+}
+
+// The pixels of a row are already clipped to the tile, so they are written straight into the frame and z-buffer rows.
+template <typename ShaderType>
+void Renderer::shade_blocks(const Triangle& triangle, int y, const PixelBlock* blocks, int num_blocks, RenderStats& tile_stats)
+{
+	float* depth_row = depth_buffer.row(y);
+
+	if constexpr (std::is_same<ShaderType, VisibilityPass>::value)
+	{
+		const Triangle** visibility_row = visibility.data() + (y * frame.w);
+		for (int b = 0; b < num_blocks; b++)
+		{
+			const PixelBlock& block = blocks[b];
+			for (int lane = 0; lane < PixelBlock::WIDTH; lane++)
+			{
+				if ((block.mask & (1u << lane)) == 0) continue;
+
+				depth_row[block.x + lane] = block.wn[lane];
+				visibility_row[block.x + lane] = &triangle;
+			}
+		}
+	} else
+	{
+		const ShaderType& pixel_shader = static_cast<const ShaderType&>(shader);
+		const DrawUniforms& uniforms = rasterizing->packet.draws[triangle.draw];
+		uint32_t* color_row = rasterizing->target->buffer + (y * frame.w);
+
+		for (int b = 0; b < num_blocks; b++)
+		{
+			const PixelBlock& block = blocks[b];
+			for (int lane = 0; lane < PixelBlock::WIDTH; lane++)
+			{
+				if ((block.mask & (1u << lane)) == 0) continue;
+
+				int i = block.x + lane;
+				vec4 barycentric(block.b0[lane], block.b1[lane], block.b2[lane], block.wn[lane]);
+				uint32_t color;
+				bool discard = pixel_shader.fragment(uniforms, barycentric, triangle.varyings, color);
+				tile_stats.fragments_shaded++;
+
+				if (!discard)
+				{
+					depth_row[i] = block.wn[lane];
+					color_row[i] = color;
+				}
+			}
+		}
+	}
+}
+
+// The second pass of deferred shading. Every pixel that ended up covered is shaded exactly once, with the triangle
+// the visibility buffer recorded for it. Its barycentrics are recomputed from the triangle's edge functions,
+// which gives the same values the raster pass had, so the image matches forward shading.
+template <typename ShaderType>
+void Renderer::resolve_tile(int min_x, int min_y, int max_x, int max_y, RenderStats& tile_stats)
+{
+	const ShaderType& pixel_shader = static_cast<const ShaderType&>(shader);
+
+	for (int j = min_y; j <= max_y; j++)
+	{
+		const Triangle* const* visibility_row = visibility.data() + (j * frame.w);
+		uint32_t* color_row = rasterizing->target->buffer + (j * frame.w);
+
+		for (int i = min_x; i <= max_x; i++)
+		{
+			if (visibility_row[i] == nullptr) continue;
+
+			const Triangle& triangle = *visibility_row[i];
+			vec4 barycentric = pixel_barycentric(triangle.setup, i, j);
+			uint32_t color;
+			bool discard = pixel_shader.fragment(rasterizing->packet.draws[triangle.draw], barycentric, triangle.varyings, color);
+			tile_stats.fragments_shaded++;
+
+			if (!discard)
+			{
+				color_row[i] = color;
+			}
+		}
+	}
+}
+
+void Renderer::draw_wireframe_triangle(std::vector<vec4> coords)
+{
+    draw_line(coords[0].x, coords[0].y, coords[1].x, coords[1].y);
+    draw_line(coords[1].x, coords[1].y, coords[2].x, coords[2].y);
+    draw_line(coords[2].x, coords[2].y, coords[0].x, coords[0].y);
+}
+
+void Renderer::draw_line(int x0, int y0, int x1, int y1)
+{
+    int x = x0;
+    int y = y0;
+    int dx = std::abs(x1 - x0);
+    int dy = std::abs(y1 - y0);
+    bool steep = false;
+
+    if (dy > dx)
+    {
+        std::swap(x0, y0);
+        std::swap(x1, y1);
+        std::swap(x, y);
+        std::swap(dx, dy);
+        steep = true;
+    }
+
+    int P = 2*dy - dx;
+
+    bool decrement_x = (x0 > x1);
+    bool decrement_y = (y0 > y1);
+
+    while ((decrement_x) ? x >= x1 : x <= x1)
+    {
+        if (steep)
+        {
+            frame.set_pixel(y, x, 0xffff0000);
+        } else
+        {
+            frame.set_pixel(x, y, 0xffff0000); }
+        if (P < 0)
+        {
+            P = P + 2*dy;
+        } else
+        {
+            P = P + 2*dy - 2*dx;
+            if (decrement_y)
+            {
+                --y;
+            } else
+            {
+                ++y;
+            }
+        }
+        
+        if (decrement_x)
+        {
+            --x;
+        } else
+        {
+            ++x;
+        }
+    }
 }
\ No newline at end of file
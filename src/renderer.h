@@ -1,29 +1,253 @@
-#pragma once
-#include <vector>
-#include "world.h"
-#include "texture.h"
-#include "frame.h"
-#include "vec2.h"
-#include "vec3.h"
-#include "vec4.h"
-#include "mat4.h"
-#include "shaders/shader.h"
-
-class Renderer
-{
-    public:
-        Renderer() = default;
-        Renderer(World& w, Frame& f, Shader& s);
-        void render();
-
-    private:
-		void draw_triangle(std::vector<vec4> coords);
-        void draw_wireframe_triangle(std::vector<vec4> coords);
-        void draw_line(int x0, int y0, int x1, int y1);
-        void setup_zbuffer();
-        
-        World& world;
-        Frame& frame;
-        Shader& shader;
-        float* z_buffer = nullptr; // TODO: deallocate z_buffer
-};
+#pragma once
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "world.h"
+#include "texture.h"
+#include "frame.h"
+#include "vec2.h"
+#include "vec3.h"
+#include "vec4.h"
+#include "mat4.h"
+#include "thread_pool.h"
+#include "rasterizer.h"
+#include "render_stats.h"
+#include "clipper.h"
+#include "depth_buffer.h"
+#include "occlusion_buffer.h"
+#include "shaders/shader.h"
+
+// Forward shades each pixel that passes the depth test while the triangles are drawn, so hidden pixels that are drawn
+// first get shaded too. Deferred first draws only the depth and the nearest triangle's index at each pixel
+// (a visibility buffer), and then shades every covered pixel exactly once.
+// A pixel that the shader discards in deferred mode keeps the background, so such shaders need forward shading.
+enum class ShadingMode
+{
+    Forward,
+    Deferred
+};
+
+class Renderer
+{
+    public:
+        Renderer() = default;
+        Renderer(World& w, Frame& f, Shader& s);
+        ~Renderer();
+
+        // Records a frame from the world's current state and draws it. Returns the frame to show, which stays untouched
+        // until the next call, or nullptr while a pipeline deeper than one frame is still filling up.
+        // With a pipeline depth of 1 this draws the frame into the Frame the renderer was made with, and returns it.
+        // If that Frame has changed size since the last call, the frames still in flight are dropped, and a deeper
+        // pipeline fills up again at the new size.
+        // Culling is part of recording, so it is done before render() returns at any depth: the bounding spheres are
+        // tested as jobs, but the BVH query and the occlusion buffer run on the calling thread.
+        Frame* render();
+
+        // How many frames are in flight at once. At 2, render() starts on the geometry of the frame it records and lets
+        // it run on the workers while it rasterizes the frame before, which it then returns; at 3, the rasterization
+        // runs on in the background too, while the caller shows the frame before that. Throughput goes up, since no
+        // stage waits on another to drain, but what is shown lags depth - 1 calls behind the world, which get_stats()
+        // reports as latency. Frames after the first are drawn into frames of their own, copied from the renderer's.
+        // Changing the depth finishes the frames in flight and drops them. Meshes and their textures must stay alive
+        // until every frame that draws them has been returned.
+        void set_pipeline_depth(int frames);
+        int get_pipeline_depth() const;
+        static constexpr int MAX_PIPELINE_DEPTH = 3;
+
+        // Defaults to the widest SIMD path the CPU supports. Scalar is the reference implementation.
+        void set_simd_level(SimdLevel level);
+        SimdLevel get_simd_level() const;
+
+        void set_shading_mode(ShadingMode mode);
+        ShadingMode get_shading_mode() const;
+
+        // On by default. Only does anything while some visible object is an occluder (see Object::setOccluder).
+        void set_occlusion_culling(bool enabled);
+        bool get_occlusion_culling() const;
+
+        // Objects are drawn from the coarsest level of detail of their mesh (see Mesh::buildLods) whose error, projected
+        // onto the screen at the object's nearest point, is at most this many pixels. 0 always draws the full meshes.
+        void set_lod_threshold(float pixels);
+        float get_lod_threshold() const;
+        static constexpr float DEFAULT_LOD_THRESHOLD = 1.0f;
+
+        // Counters from the frame that the last call to render() returned.
+        const RenderStats& get_stats() const;
+
+        // What pixels that no triangle covers are left as.
+        static constexpr uint32_t BACKGROUND_COLOR = 0xADD8E6;
+
+        // The screen is split into square tiles of this many pixels, which are rasterized in parallel.
+        static constexpr int TILE_SIZE = 64;
+        // Within a tile, triangles are first classified against square blocks of this many pixels.
+        static constexpr int COARSE_BLOCK_SIZE = 8;
+        static_assert(COARSE_BLOCK_SIZE == DepthBuffer::BLOCK_SIZE, "coarse blocks are tested against the depth buffer's block depths");
+
+    private:
+        // A triangle that has gone through the vertex stage, ready to be rasterized.
+        struct Triangle
+        {
+            vec4 coords[3];
+            Varyings varyings[3];
+            TriangleSetup setup;
+            int draw = 0; // Index into the packet's draws, for the uniforms of the object the triangle came from.
+        };
+
+        // A vertex after the perspective divide and viewport transform, with its varyings divided by w.
+        struct ScreenVertex
+        {
+            vec4 position;
+            Varyings varyings;
+        };
+
+        // A run of consecutive triangles of one draw's level of detail: whole meshlets, or a range of triangles if the
+        // level has none.
+        struct DrawPiece
+        {
+            int draw = 0;
+            const MeshLod* lod = nullptr;
+            const Mesh* mesh = nullptr;
+            size_t meshlet_begin = 0;
+            size_t meshlet_end = 0;
+            size_t triangle_begin = 0;
+            size_t triangle_end = 0;
+        };
+
+        // Consecutive pieces that one job takes through the vertex stage, clipping and binning. Every batch has its own
+        // scratch space, triangles and bins, so that batches never share anything while they run.
+        struct GeometryBatch
+        {
+            std::vector<DrawPiece> pieces;
+            size_t triangle_count = 0;
+
+            // The current piece's triangles that survived meshlet culling, as [begin, end) ranges of triangle indices,
+            // and whether each vertex in [vertex_begin, vertex_begin + vertex_visible.size()) is used by one of them.
+            std::vector<std::pair<size_t, size_t>> visible_triangles;
+            std::vector<uint32_t> visible_meshlets;
+            std::vector<uint8_t> vertex_visible;
+            size_t vertex_begin = 0;
+            // Vertex stage output for the current piece, by vertex index minus vertex_begin. Only filled in for visible vertices.
+            std::vector<vec4> clip_positions;
+            std::vector<Varyings> clip_varyings;
+            std::vector<int> outcodes;
+            std::vector<ScreenVertex> screen_vertices; // Only filled in for vertices in front of the eye (w > 0).
+
+            std::vector<Triangle> triangles;
+            std::vector<std::vector<int>> tile_bins; // Indices into triangles, in submission order.
+            RenderStats stats;
+        };
+
+        // Everything a frame is drawn from, copied out of the world and the renderer's settings when the frame is recorded,
+        // so that both can move on to the next frame while this one is still being drawn. Nothing in it changes after that.
+        struct FramePacket
+        {
+            vec3 eye;
+            vec3 look_at;
+            vec3 light;
+            ShadingMode shading_mode = ShadingMode::Forward;
+            SimdLevel simd_level = SimdLevel::Scalar;
+            std::vector<DrawUniforms> draws; // One per object or copy drawn, with its transform.
+            std::chrono::steady_clock::time_point recorded;
+        };
+
+        // A frame on its way through the pipeline: its packet, the geometry batches made from it, and the image they are
+        // drawn into. Frames are reused round robin, with their allocations.
+        struct FrameInFlight
+        {
+            FramePacket packet;
+            // The frame's geometry, split into batches of about GEOMETRY_BATCH_TRIANGLES triangles in submission order.
+            // Only the first batch_count are used.
+            std::vector<GeometryBatch> batches;
+            size_t batch_count = 0;
+            Frame* target = nullptr;
+            std::unique_ptr<Frame> own_target; // For pipelines deeper than one frame.
+            RenderStats stats;
+            JobCounter geometry_jobs;
+            JobCounter raster_jobs;
+        };
+
+        void record_frame(FrameInFlight& frame_in_flight);
+        void process_geometry(FrameInFlight& frame_in_flight);
+        void rasterize_frame(FrameInFlight& frame_in_flight);
+        Frame* finish_frame(FrameInFlight& frame_in_flight);
+        void drain_pipeline();
+        void reset_pipeline(int depth);
+        void cull_objects(const FramePacket& packet, const FrustumPlanes& frustum, const std::function<bool(const AABB&)>& occluded = nullptr);
+        void cull_occluded_objects(const FramePacket& packet, const FrustumPlanes& frustum, const mat4& view_projection, RenderStats& frame_stats);
+        void cull_instances(const FramePacket& packet, const InstancedObject& instances, const FrustumPlanes& frustum, RenderStats& frame_stats);
+        template <typename SphereFunction> size_t cull_bounding_spheres(const FrustumPlanes& frustum, size_t count, const SphereFunction& sphere);
+        DrawUniforms setup_draw(const FramePacket& packet, const DrawUniforms& frame_uniforms, const mat4& model, const mat4& view_projection) const;
+        size_t select_lod(const FramePacket& packet, const Mesh& mesh, const BoundingSphere& world_sphere) const;
+        void add_draw(FrameInFlight& frame_in_flight, const Mesh& mesh, int draw, size_t level);
+        GeometryBatch& open_batch(FrameInFlight& frame_in_flight);
+        void process_batch(const FramePacket& packet, GeometryBatch& batch);
+        void draw_piece(const FramePacket& packet, GeometryBatch& batch, const DrawPiece& piece);
+        void cull_meshlets(GeometryBatch& batch, const DrawPiece& piece, const DrawUniforms& uniforms);
+        void shade_vertices(GeometryBatch& batch, const Mesh& mesh, const DrawUniforms& uniforms);
+        void project_vertices(GeometryBatch& batch, const DrawUniforms& uniforms);
+        void clip_and_submit(const FramePacket& packet, GeometryBatch& batch, const uint32_t (&corners)[3], int draw);
+        void submit_triangle(GeometryBatch& batch, const ScreenVertex& a, const ScreenVertex& b, const ScreenVertex& c, int draw);
+        void project(const DrawUniforms& uniforms, const vec4& clip, const Varyings& varyings, ScreenVertex& out) const;
+        void bin_triangles(GeometryBatch& batch);
+
+        // The pixel loops are templates on the shader type, so that the shader's fragment() can be inlined into them.
+        // Instantiated with VisibilityPass, they write the visibility buffer instead of shading.
+        struct VisibilityPass {};
+        using TileFunction = void (Renderer::*)(int tile);
+        TileFunction select_tile_function() const;
+        template <typename ShaderType> void rasterize_tile(int tile);
+        template <typename ShaderType> void draw_tile_triangles(int tile, int min_x, int min_y, int max_x, int max_y);
+        template <typename ShaderType> void resolve_tile(int min_x, int min_y, int max_x, int max_y, RenderStats& tile_stats);
+        template <typename ShaderType> bool draw_triangle_blocks(const Triangle& triangle, int min_x, int min_y, int max_x, int max_y, RenderStats& tile_stats);
+        template <typename ShaderType> void shade_blocks(const Triangle& triangle, int y, const PixelBlock* blocks, int num_blocks, RenderStats& tile_stats);
+        void draw_wireframe_triangle(std::vector<vec4> coords);
+        void draw_line(int x0, int y0, int x1, int y1);
+        
+        World& world;
+        Frame& frame;
+        Shader& shader;
+        DepthBuffer depth_buffer;
+        ShadingMode shading_mode = ShadingMode::Forward;
+        bool occlusion_culling = true;
+        OcclusionBuffer occlusion_buffer;
+        bool occlusion_active = false; // Whether any occluder was drawn into occlusion_buffer this frame.
+        float lod_threshold = DEFAULT_LOD_THRESHOLD;
+        float lod_scale = 0; // Pixels that one unit of length at a distance of one unit spans on the screen this frame.
+
+        // Deferred mode only: the nearest triangle at each pixel, or nullptr.
+        std::vector<const Triangle*> visibility;
+
+        SimdLevel simd_level = detect_simd_level();
+        ThreadPool& thread_pool = ThreadPool::shared();
+        int tiles_x = 0;
+        int tiles_y = 0;
+        // The size of the window when it was split into tiles and the frames in flight were made.
+        int frame_w = 0;
+        int frame_h = 0;
+        // The objects the world's BVH found in the frustum, or the copies of the current instanced object, their world-space
+        // bounding spheres as separate arrays so that they can be culled four at a time, whether each survived that,
+        // and those that did.
+        std::vector<Object*> candidate_objects;
+        std::vector<float> object_x;
+        std::vector<float> object_y;
+        std::vector<float> object_z;
+        std::vector<float> object_radius;
+        std::vector<uint8_t> object_visible;
+        std::vector<Object*> visible_objects;
+        std::vector<uint32_t> visible_instances;
+        std::vector<float> instance_distances; // Squared, from the eye to each visible copy, for sorting them.
+        // Geometry batches are closed once they hold this many triangles.
+        static constexpr size_t GEOMETRY_BATCH_TRIANGLES = 8192;
+        // Bounding spheres culled by one job.
+        static constexpr size_t CULL_BATCH_OBJECTS = 4096;
+
+        // The frames in flight, one per pipeline stage, by the number of the frame modulo the depth.
+        int pipeline_depth = 1;
+        std::vector<std::unique_ptr<FrameInFlight>> frames_in_flight;
+        uint64_t frames_recorded = 0;
+        const FrameInFlight* rasterizing = nullptr; // Frames are rasterized one at a time, since they share the depth buffer.
+        std::vector<RenderStats> tile_stats;     // Each tile counts separately so that workers never share counters.
+        RenderStats stats;
+};
@@ -1,9 +1,8 @@
 #pragma once
 #include "shader.h"
-#include "graphics.h"
 #include <algorithm>
 
-class GouraudShader : public Shader
+class GouraudShader final : public Shader
 {
     public:
         GouraudShader(World& World, Frame& Frame) : 
@@ -15,33 +14,68 @@ class GouraudShader : public Shader
         {
         }
 
-        vec4 vertex(const Vertex& vertex, const mat4& model, int num_vert) override
+        vec4 vertex(const DrawUniforms& uniforms, const Vertex& vertex, Varyings& varyings) const override
         {
-            // TODO: pass in t,b,l,r,n,f for perspective
-            // TODO: do actual clipping?
-            vec4 model_coords = model * vertex.position;
-			vec4 model_normals = inverse(transpose(model)) * vertex.normal;
-            vec4 clip_coords = perspective() * lookAt(world.get_eye(), world.get_look_at_pt()) * model_coords;
-            vec4 ndcs = clip_coords / clip_coords.w; 
-            vec4 viewport_coords = viewport(frame) * ndcs;
-            viewport_coords.x = (int) viewport_coords.x; // Convert to int to avoid black gaps between triangles.
-            viewport_coords.y = (int) viewport_coords.y; // Convert to int to avoid black gaps between triangles.
-            viewport_coords.w = clip_coords.w; // Keep wn (aka -z) for perspective-correct linear interpolation.
-
-			// https://www.scratchapixel.com/lessons/3d-basic-rendering/rasterization-practical-implementation/perspective-correct-interpolation-vertex-attributes
-			// we must divide vertex attributes by z first before linearly interpolating
-			intensities[num_vert] = dot(vec3(model_normals).normalize(), world.get_light().normalize()) / viewport_coords.w;
-
-            return viewport_coords;
+			vec4 world_normal = uniforms.normal_matrix * vertex.normal;
+			varyings.v[0] = dot(vec3(world_normal).normalize(), uniforms.light_direction);
+
+            return uniforms.mvp * vertex.position;
+        }
+
+        bool vertex_batch(const DrawUniforms& uniforms, const VertexStreams& streams, vec4* positions, Varyings* varyings) const override
+        {
+            size_t count = streams.size();
+            transform_points(uniforms.mvp, streams.x.data(), streams.y.data(), streams.z.data(), positions, count);
+
+            const mat4& N = uniforms.normal_matrix;
+            const vec3& L = uniforms.light_direction;
+
+            size_t i = 0;
+#ifdef MATH_SIMD
+            // The same arithmetic as vertex(), on four normals at a time.
+            for (; i + 4 <= count; i += 4)
+            {
+                __m128 nx = _mm_loadu_ps(streams.nx.data() + i);
+                __m128 ny = _mm_loadu_ps(streams.ny.data() + i);
+                __m128 nz = _mm_loadu_ps(streams.nz.data() + i);
+
+                __m128 wx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(N(0, 0)), nx), _mm_mul_ps(_mm_set1_ps(N(0, 1)), ny)), _mm_mul_ps(_mm_set1_ps(N(0, 2)), nz));
+                __m128 wy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(N(1, 0)), nx), _mm_mul_ps(_mm_set1_ps(N(1, 1)), ny)), _mm_mul_ps(_mm_set1_ps(N(1, 2)), nz));
+                __m128 wz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(N(2, 0)), nx), _mm_mul_ps(_mm_set1_ps(N(2, 1)), ny)), _mm_mul_ps(_mm_set1_ps(N(2, 2)), nz));
+
+                __m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(wx, wx), _mm_mul_ps(wy, wy)), _mm_mul_ps(wz, wz)));
+                __m128 scale = _mm_div_ps(_mm_set1_ps(1.0f), length);
+                wx = _mm_mul_ps(wx, scale);
+                wy = _mm_mul_ps(wy, scale);
+                wz = _mm_mul_ps(wz, scale);
+
+                __m128 intensity = _mm_add_ps(_mm_add_ps(_mm_mul_ps(wx, _mm_set1_ps(L.x)), _mm_mul_ps(wy, _mm_set1_ps(L.y))), _mm_mul_ps(wz, _mm_set1_ps(L.z)));
+
+                alignas(16) float lanes[4];
+                _mm_store_ps(lanes, intensity);
+                for (int lane = 0; lane < 4; lane++)
+                {
+                    varyings[i + lane] = Varyings();
+                    varyings[i + lane].v[0] = lanes[lane];
+                }
+            }
+#endif
+            for (; i < count; i++)
+            {
+                vec4 world_normal = N * vec4(streams.nx[i], streams.ny[i], streams.nz[i], 0);
+                varyings[i] = Varyings();
+                varyings[i].v[0] = dot(vec3(world_normal).normalize(), L);
+            }
+            return true;
         }
 
-        bool fragment(const vec4& barycentric, uint32_t& color) override
+        bool fragment(const DrawUniforms& uniforms, const vec4& barycentric, const Varyings (&varyings)[3], uint32_t& color) const override
         {
-			float intensity = barycentric.w * ((intensities[0] * barycentric.x) + (intensities[1] * barycentric.y) + (intensities[2] * barycentric.z));
-			float rgb = std::clamp(intensity, 0.0f, 1.0f) * 255;
-			color = SDL_MapRGBA(frame.pixel_format, rgb, rgb, rgb, 255);
+			float intensity[1];
+			interpolate(barycentric, varyings, intensity);
+			float rgb = std::clamp(intensity[0], 0.0f, 1.0f) * 255;
+			const vec4& tint = uniforms.instance_parameters;
+			color = SDL_MapRGBA(frame.pixel_format, rgb * tint.x, rgb * tint.y, rgb * tint.z, 255);
             return false;
         }
-    private:
-        vec3 intensities;
 };
\ No newline at end of file
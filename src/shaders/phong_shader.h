@@ -1,14 +1,13 @@
 #pragma once
 #include "shader.h"
-#include "graphics.h"
 #include "vec2.h"
 #include <vector>
 
-class PhongShader : public Shader
+class PhongShader final : public Shader
 {
 public:
 	PhongShader(World& World, Frame& Frame) :
-		Shader(World, Frame), normals(3, vec3()), world_positions(3, vec3()), uvs(3, vec3())
+		Shader(World, Frame)
 	{
 	}
 
@@ -16,36 +15,52 @@ public:
 	{
 	}
 
-	vec4 vertex(const Vertex& vertex, const mat4& model, int num_vert) override
+	vec4 vertex(const DrawUniforms& uniforms, const Vertex& vertex, Varyings& varyings) const override
 	{
-		// TODO: pass in t,b,l,r,n,f for perspective
-		// TODO: do actual clipping?
-		vec4 model_coords = model * vertex.position;
-		vec4 model_normals = inverse(transpose(model)) * vertex.normal;
-		vec4 clip_coords = perspective() * lookAt(world.get_eye(), world.get_look_at_pt()) * model_coords;
-		vec4 ndcs = clip_coords / clip_coords.w;
-		vec4 viewport_coords = viewport(frame) * ndcs;
-		viewport_coords.x = (int)viewport_coords.x; // Convert to int to avoid black gaps between triangles.
-		viewport_coords.y = (int)viewport_coords.y; // Convert to int to avoid black gaps between triangles.
-		viewport_coords.w = clip_coords.w; // Keep wn (aka -z) for perspective-correct linear interpolation.
-
-		// https://www.scratchapixel.com/lessons/3d-basic-rendering/rasterization-practical-implementation/perspective-correct-interpolation-vertex-attributes
-		// we must divide vertex attributes by z first before linearly interpolating
-		normals[num_vert] = model_normals / viewport_coords.w;
-		world_positions[num_vert] = vertex.position / viewport_coords.w;
-		uvs[num_vert] = vertex.uv / viewport_coords.w;
-
-		return viewport_coords;
+		// Lighting happens in object space, where the eye and light were already moved to by the renderer.
+		varyings.v[NORMAL + 0] = vertex.normal.x;
+		varyings.v[NORMAL + 1] = vertex.normal.y;
+		varyings.v[NORMAL + 2] = vertex.normal.z;
+		varyings.v[OBJECT_POSITION + 0] = vertex.position.x;
+		varyings.v[OBJECT_POSITION + 1] = vertex.position.y;
+		varyings.v[OBJECT_POSITION + 2] = vertex.position.z;
+		varyings.v[UV + 0] = vertex.uv.x;
+		varyings.v[UV + 1] = vertex.uv.y;
+
+		return uniforms.mvp * vertex.position;
+	}
+
+	bool vertex_batch(const DrawUniforms& uniforms, const VertexStreams& streams, vec4* positions, Varyings* varyings) const override
+	{
+		size_t count = streams.size();
+		transform_points(uniforms.mvp, streams.x.data(), streams.y.data(), streams.z.data(), positions, count);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			float* v = varyings[i].v;
+			v[NORMAL + 0] = streams.nx[i];
+			v[NORMAL + 1] = streams.ny[i];
+			v[NORMAL + 2] = streams.nz[i];
+			v[OBJECT_POSITION + 0] = streams.x[i];
+			v[OBJECT_POSITION + 1] = streams.y[i];
+			v[OBJECT_POSITION + 2] = streams.z[i];
+			v[UV + 0] = streams.u[i];
+			v[UV + 1] = streams.v[i];
+		}
+		return true;
 	}
 
-	bool fragment(const vec4& barycentric, uint32_t& color) override
+	bool fragment(const DrawUniforms& uniforms, const vec4& barycentric, const Varyings (&varyings)[3], uint32_t& color) const override
 	{
-		vec3 normal = (((normals[0] * barycentric.x) + (normals[1] * barycentric.y) + (normals[2] * barycentric.z)) * barycentric.w).normalize();
-		vec3 world_position = ((world_positions[0] * barycentric.x) + (world_positions[1] * barycentric.y) + (world_positions[2] * barycentric.z)) * barycentric.w;
-		vec2 uv = ((uvs[0] * barycentric.x) + (uvs[1] * barycentric.y) + (uvs[2] * barycentric.z)) * barycentric.w;
+		float v[NUM_VARYINGS];
+		interpolate(barycentric, varyings, v);
+
+		vec3 normal = vec3(v[NORMAL], v[NORMAL + 1], v[NORMAL + 2]).normalize();
+		vec3 object_position(v[OBJECT_POSITION], v[OBJECT_POSITION + 1], v[OBJECT_POSITION + 2]);
+		vec2 uv(v[UV], v[UV + 1]);
 
-		vec3 to_eye = (world.get_eye() - world_position).normalize();
-		vec3 to_light = (world.get_light() - world_position).normalize();
+		vec3 to_eye = (uniforms.eye - object_position).normalize();
+		vec3 to_light = (uniforms.light - object_position).normalize();
 
 		vec3 proj_of_to_light_on_normal = (normal * dot(to_light, normal));
 		vec3 to_reflection_pos = (proj_of_to_light_on_normal - to_light) * 2;
@@ -61,6 +76,7 @@ public:
 		float phong_term = ka + (kd * diffuse) + (ks * specular);
 
 		float r = 255.0f, g = 255.0f, b = 255.0f;
+		const Texture* texture = uniforms.texture.get();
         if (texture != nullptr)
         {
             uint32_t u = (uint32_t) std::floor(uv.x * texture->width);
@@ -73,11 +89,14 @@ public:
             b = (float) texture->data[idx++];
         }
 
-		color = SDL_MapRGBA(frame.pixel_format, r * phong_term, g * phong_term, b * phong_term, 255);
+		const vec4& tint = uniforms.instance_parameters;
+		color = SDL_MapRGBA(frame.pixel_format, r * phong_term * tint.x, g * phong_term * tint.y, b * phong_term * tint.z, 255);
 		return false;
 	}
 private:
-	std::vector<vec3> normals;
-	std::vector<vec3> world_positions;
-	std::vector<vec2> uvs;
+	// Offsets of each attribute inside Varyings.
+	static constexpr int NORMAL = 0;
+	static constexpr int OBJECT_POSITION = 3;
+	static constexpr int UV = 6;
+	static constexpr int NUM_VARYINGS = 8;
 };
\ No newline at end of file
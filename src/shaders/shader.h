@@ -3,7 +3,55 @@
 #include "../frame.h"
 #include "../vec4.h"
 #include "../vec3.h"
+#include "../mat4.h"
+#include "../texture.h"
+#include <memory>
 
+// Per-vertex outputs of the vertex stage that get interpolated across a triangle for the fragment stage.
+// The vertex stage writes plain attribute values. After clipping, the renderer divides them by w,
+// so that the fragment stage receives them ready for perspective-correct interpolation.
+struct Varyings
+{
+    static constexpr int MAX_VARYINGS = 8;
+    float v[MAX_VARYINGS] = {};
+};
+
+// Everything a shader needs that stays the same for a whole draw, i.e. one object, or one copy of an instanced object,
+// in one frame.
+// The renderer computes it once per draw instead of the shader rebuilding the matrices for every vertex.
+struct DrawUniforms
+{
+    mat4 model;
+    mat4 mvp;           // Object space to clip space: projection * view * model.
+    mat4 viewport;      // NDC to screen space, applied by the renderer after clipping.
+    mat4 normal_matrix; // Object space normals to world space.
+
+    // Lighting inputs. eye and light are positions in object space, so per-vertex values need no transform.
+    vec3 eye;
+    vec3 light;
+    vec3 light_direction; // World space, normalized.
+
+    std::shared_ptr<Texture> texture;
+
+    // The copy's own parameters for an instanced object (see InstancedObject), and (1, 1, 1, 1) otherwise.
+    // The shaders here tint their color by x, y and z.
+    vec4 instance_parameters = vec4(1, 1, 1, 1);
+};
+
+// Perspective-correct interpolation of the first N varyings at a pixel. barycentric holds the pixel's weights in x, y
+// and z and its interpolated w in w; the renderer has already divided the varyings at each corner by w.
+template <int N>
+inline void interpolate(const vec4& barycentric, const Varyings (&varyings)[3], float (&out)[N])
+{
+    static_assert(N <= Varyings::MAX_VARYINGS, "interpolating more varyings than there are");
+    for (int k = 0; k < N; k++)
+    {
+        out[k] = ((varyings[0].v[k] * barycentric.x) + (varyings[1].v[k] * barycentric.y) + (varyings[2].v[k] * barycentric.z)) * barycentric.w;
+    }
+}
+
+// Shaders that derive from this and are marked final get their fragment() inlined into the renderer's pixel loops,
+// once the renderer knows about them (see Renderer::select_tile_function). Others work too, through a virtual call per pixel.
 class Shader
 {
     public:
@@ -16,14 +64,18 @@ class Shader
         {
         }
 
-        virtual vec4 vertex(const Vertex& vertex, const mat4& model, int num_vert)=0;
-        virtual bool fragment(const vec4& barycentric, uint32_t& color)=0;
-		void set_texture(std::shared_ptr<Texture> Texture)
-		{
-			texture = Texture;
-		}
+        // Returns the vertex position in homogeneous clip space.
+        virtual vec4 vertex(const DrawUniforms& uniforms, const Vertex& vertex, Varyings& varyings) const=0;
+        // Optional batched version of vertex(), which runs over every vertex of the streams at once, so that it can use SIMD.
+        // Writes clip-space positions and varyings for vertex i to positions[i] and varyings[i].
+        // Returns false if the shader doesn't have one, and the renderer then calls vertex() for each vertex instead.
+        virtual bool vertex_batch(const DrawUniforms& /*uniforms*/, const VertexStreams& /*streams*/, vec4* /*positions*/, Varyings* /*varyings*/) const
+        {
+            return false;
+        }
+        // Called from several threads at once, so it must not modify the shader.
+        virtual bool fragment(const DrawUniforms& uniforms, const vec4& barycentric, const Varyings (&varyings)[3], uint32_t& color) const=0;
     protected:
         World& world;
         Frame& frame;
-		std::shared_ptr<Texture> texture;
 };
\ No newline at end of file
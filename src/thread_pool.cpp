@@ -0,0 +1,249 @@
+#include "thread_pool.h"
+
+namespace
+{
+    // Times an idle worker looks for a job, yielding in between, before it goes to sleep.
+    // Keeps workers at hand between the phases of a frame without burning a core while nothing is being rendered.
+    constexpr int IDLE_SPINS = 64;
+
+    // Times a thread waiting on a counter looks for a job, yielding in between, before it blocks until the count drops
+    // to zero. The rest of a group is usually a few jobs that are already running, and not worth a core spinning on.
+    constexpr int WAIT_SPINS = 64;
+
+    // The pool whose worker the current thread is, if any, and which worker.
+    thread_local const ThreadPool* current_pool = nullptr;
+    thread_local int current_worker = -1;
+
+    // Where a thief starts looking, so that thieves spread over the deques instead of all trying the same one first.
+    thread_local uint32_t steal_seed = 0x9E3779B9;
+}
+
+ThreadPool::ThreadPool(unsigned int num_threads)
+{
+    // The calling thread always helps out, so we only need to spawn the rest.
+    for (unsigned int i = 1; i < num_threads; i++)
+    {
+        deques.push_back(std::make_unique<WorkStealingDeque<Job*>>(DEQUE_CAPACITY));
+    }
+    for (int i = 0; i < (int) deques.size(); i++)
+    {
+        workers.emplace_back(&ThreadPool::worker_loop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        stopping = true;
+    }
+    work_ready.notify_all();
+
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::shared()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+int ThreadPool::worker_index() const
+{
+    return current_pool == this ? current_worker : -1;
+}
+
+void ThreadPool::push(Job* job)
+{
+    job->counter->pending.fetch_add(1, std::memory_order_relaxed);
+    if (workers.empty())
+    {
+        execute(job);
+        return;
+    }
+
+    int worker = worker_index();
+    if (worker >= 0)
+    {
+        if (!deques[worker]->push(job))
+        {
+            execute(job);
+            return;
+        }
+    } else
+    {
+        std::lock_guard<std::mutex> lock(shared_mutex);
+        shared_jobs.push_back(job);
+        shared_count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // A worker that is going to sleep either sees this job counted, or is seen to be sleeping and woken up.
+    queued.fetch_add(1, std::memory_order_seq_cst);
+    if (sleeping.load(std::memory_order_seq_cst) > 0)
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+        }
+        work_ready.notify_one();
+    }
+}
+
+// A worker's own deque first, then the shared queue, then the other workers' deques.
+ThreadPool::Job* ThreadPool::find_job(int worker)
+{
+    Job* job = nullptr;
+    if (worker >= 0 && deques[worker]->pop(job))
+    {
+        queued.fetch_sub(1, std::memory_order_relaxed);
+        return job;
+    }
+
+    if (shared_count.load(std::memory_order_relaxed) > 0)
+    {
+        std::lock_guard<std::mutex> lock(shared_mutex);
+        if (!shared_jobs.empty())
+        {
+            job = shared_jobs.front();
+            shared_jobs.pop_front();
+            shared_count.fetch_sub(1, std::memory_order_relaxed);
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+
+    steal_seed ^= steal_seed << 13;
+    steal_seed ^= steal_seed >> 17;
+    steal_seed ^= steal_seed << 5;
+    size_t count = deques.size();
+    for (size_t i = 0; i < count; i++)
+    {
+        size_t victim = (steal_seed + i) % count;
+        if ((int) victim == worker) continue;
+        if (deques[victim]->steal(job))
+        {
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+// The job is gone before its counter drops, since a waiting thread may destroy the counter as soon as it is zero.
+// For the same reason only the pool is touched once it has.
+void ThreadPool::execute(Job* job)
+{
+    JobCounter* counter = job->counter;
+    job->run();
+    delete job;
+
+    // A thread that is going to block on the counter either sees it at zero, or is seen to be blocked and woken up.
+    if (counter->pending.fetch_sub(1, std::memory_order_seq_cst) == 1 && blocked.load(std::memory_order_seq_cst) > 0)
+    {
+        {
+            std::lock_guard<std::mutex> lock(wait_mutex);
+        }
+        counter_done.notify_all();
+    }
+}
+
+// Blocking is safe once nothing is left to take: the jobs of the group that are still queued are found by the threads
+// that spawned them, which are running, and look in their own deque before they wait or sleep themselves.
+void ThreadPool::wait(JobCounter& counter)
+{
+    int worker = worker_index();
+    int idle = 0;
+    while (!counter.done())
+    {
+        Job* job = find_job(worker);
+        if (job != nullptr)
+        {
+            execute(job);
+            idle = 0;
+            continue;
+        }
+
+        // The rest of the group is running on other threads.
+        if (++idle < WAIT_SPINS)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(wait_mutex);
+        blocked.fetch_add(1, std::memory_order_seq_cst);
+        counter_done.wait(lock, [&counter] { return counter.pending.load(std::memory_order_seq_cst) == 0; });
+        blocked.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+void ThreadPool::parallel_for(int count, const std::function<void(int)>& task)
+{
+    if (count <= 0) return;
+
+    if (workers.empty() || count == 1)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            task(i);
+        }
+        return;
+    }
+
+    JobCounter counter;
+    spawn(counter, [this, &counter, count, &task] { run_range(counter, 0, count, task); });
+    wait(counter);
+}
+
+// Hands out [begin, end) by halving it: the upper half is queued for other threads to steal, and the lower half is
+// halved again, down to the single index that this thread runs. Thieves so take large ranges and split them further
+// themselves, instead of every index being queued up front by one thread.
+void ThreadPool::run_range(JobCounter& counter, int begin, int end, const std::function<void(int)>& task)
+{
+    while (end - begin > 1)
+    {
+        int middle = begin + ((end - begin) / 2);
+        spawn(counter, [this, &counter, middle, end, &task] { run_range(counter, middle, end, task); });
+        end = middle;
+    }
+    task(begin);
+}
+
+int ThreadPool::size() const
+{
+    return static_cast<int>(workers.size()) + 1;
+}
+
+void ThreadPool::worker_loop(int worker)
+{
+    current_pool = this;
+    current_worker = worker;
+    steal_seed += (uint32_t) worker * 0x632BE5AB;
+
+    int idle = 0;
+    while (true)
+    {
+        Job* job = find_job(worker);
+        if (job != nullptr)
+        {
+            execute(job);
+            idle = 0;
+            continue;
+        }
+
+        if (++idle < IDLE_SPINS)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        sleeping.fetch_add(1, std::memory_order_seq_cst);
+        work_ready.wait(lock, [this] { return stopping || queued.load(std::memory_order_seq_cst) > 0; });
+        sleeping.fetch_sub(1, std::memory_order_relaxed);
+        if (stopping && queued.load() == 0) return;
+        idle = 0;
+    }
+}
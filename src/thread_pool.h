@@ -0,0 +1,123 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "work_stealing_deque.h"
+
+// Counts the unfinished jobs of a group. A job adds children to its group by spawning them with the counter it was
+// spawned with, so that the count only drops to zero once the job and everything it spawned, however deep, has run.
+// Must outlive the jobs it counts, which waiting on it ensures.
+class JobCounter
+{
+    public:
+        JobCounter() = default;
+        JobCounter(const JobCounter&) = delete;
+        JobCounter& operator=(const JobCounter&) = delete;
+
+        bool done() const
+        {
+            return pending.load(std::memory_order_acquire) == 0;
+        }
+
+    private:
+        friend class ThreadPool;
+        std::atomic<int> pending{0};
+};
+
+// A fixed set of worker threads that are kept alive for the lifetime of the pool, so that handing out work every frame
+// does not pay for thread creation, and that run jobs: small tasks that may spawn more of them.
+//
+// Every worker has its own work-stealing deque. Jobs spawned on a worker go to the bottom of its deque and are taken back
+// from there, newest first, while idle workers steal the oldest ones from the top of the others' deques, so threads
+// don't contend over one shared queue. Jobs spawned by any other thread, like the one that made the pool, go into
+// a shared queue behind a mutex instead. A thread waiting on a counter runs jobs itself until the count drops to zero,
+// and both it and the workers only block once there is nothing left to take anywhere.
+class ThreadPool
+{
+    public:
+        explicit ThreadPool(unsigned int num_threads = std::thread::hardware_concurrency());
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // The pool the whole program shares, with a thread per core, made on first use. Loading meshes and drawing
+        // frames both run on it, so there are never more workers than cores, and none are started and stopped per load.
+        static ThreadPool& shared();
+
+        // Queues function() to run on some thread, counted in counter until it returns.
+        // A pool without workers runs it right away.
+        template <typename Function>
+        void spawn(JobCounter& counter, Function&& function)
+        {
+            push(new FunctionJob<std::decay_t<Function>>(counter, std::forward<Function>(function)));
+        }
+
+        // Runs queued jobs, of this group or any other, until the counter drops to zero.
+        // Blocks once there are none left to run while the rest of the group finishes on other threads.
+        void wait(JobCounter& counter);
+
+        // Runs task(i) for every i in [0, count), spread across the workers and the calling thread.
+        // Returns once every index has finished.
+        void parallel_for(int count, const std::function<void(int)>& task);
+
+        // Number of threads that take part in running jobs, including the calling thread.
+        int size() const;
+
+        // Jobs a worker's deque holds before further jobs spawned on that worker are run right away instead.
+        static constexpr size_t DEQUE_CAPACITY = 4096;
+
+    private:
+        struct Job
+        {
+            explicit Job(JobCounter& counter) : counter(&counter) {}
+            virtual ~Job() = default;
+            virtual void run() = 0;
+
+            JobCounter* counter;
+        };
+
+        template <typename Function>
+        struct FunctionJob : Job
+        {
+            template <typename F>
+            FunctionJob(JobCounter& counter, F&& f) : Job(counter), function(std::forward<F>(f)) {}
+            void run() override { function(); }
+
+            Function function;
+        };
+
+        void push(Job* job);
+        Job* find_job(int worker);
+        void execute(Job* job);
+        int worker_index() const;
+        void worker_loop(int worker);
+        void run_range(JobCounter& counter, int begin, int end, const std::function<void(int)>& task);
+
+        std::vector<std::thread> workers;
+        std::vector<std::unique_ptr<WorkStealingDeque<Job*>>> deques; // One per worker.
+
+        std::mutex shared_mutex;
+        std::deque<Job*> shared_jobs; // Spawned by threads that aren't workers.
+        std::atomic<int> shared_count{0};
+
+        // Jobs in any queue, and workers asleep waiting for some.
+        std::atomic<int> queued{0};
+        std::atomic<int> sleeping{0};
+        std::mutex sleep_mutex;
+        std::condition_variable work_ready;
+        std::atomic<bool> stopping{false};
+
+        // Threads blocked in wait(), woken whenever a counter drops to zero.
+        std::atomic<int> blocked{0};
+        std::mutex wait_mutex;
+        std::condition_variable counter_done;
+};
@@ -1,100 +1,115 @@
-#pragma once
-#include <iostream>
-
-// Implementation inspired by Eric Lengyel's in Foundations of Game Engine Development Vol 1.
-class vec4
-{
-    public: 
-        vec4() = default;
-
-        vec4(float X, float Y, float Z, float W)
-            : x(X), y(Y), z(Z), w(W)
-        {
-        }
-
-        float& operator[](int i)
-        {
-            return ((&x)[i]);
-        }
-
-        const float& operator[](int i) const
-        {
-            return ((&x)[i]);
-        }
-
-        vec4& operator*=(float s)
-        {
-            x *= s;
-            y *= s;
-            z *= s;
-            w *= s;
-            return *this;
-        }
-
-        vec4 operator*(float s) const
-        {
-            return vec4(x * s, y * s, z * s, w * s);
-        }
-
-        vec4& operator/=(float s)
-        {
-            s = 1.0f / s;
-            x *= s;
-            y *= s;
-            z *= s;
-            w *= s;
-            return *this;
-        }
-
-        vec4 operator/(float s) const
-        {
-            s = 1.0f / s;
-            return vec4(x * s, y * s, z * s, w * s);
-        }
-
-        vec4& operator+=(const vec4& v)
-        {
-            x += v.x;
-            y += v.y;
-            z += v.z;
-            w += v.w;
-            return *this;
-        }
-
-        vec4 operator+(const vec4& v) const
-        {
-            return vec4(x + v.x, y + v.y, z + v.z, w + v.w);
-        }
-
-        vec4& operator-=(const vec4& v)
-        {
-            x -= v.x;
-            y -= v.y;
-            z -= v.z;
-            w -= v.w;
-            return *this;
-        }
-
-        vec4 operator-(const vec4& v) const
-        {
-            return vec4(x - v.x, y - v.y, z - v.z, w - v.w);
-        }
-
-        void print() const
-        {
-            std::cout << "Vec4" << ": x = " << x << ", y = " << y << ", z = " << z << ", w = " << w << std::endl;
-        }
-
-        float x = 0;
-        float y = 0;
-        float z = 0;
-        float w = 0;
-};
-
-inline vec4 cross(const vec4& a, const vec4& b)
-{
-    return vec4((a.y * b.z - a.z * b.y),
-                (a.z * b.x - a.x * b.z), 
-                (a.x * b.y - a.y * b.x),
-                0);
+#pragma once
+#include <iostream>
+
+// vec4 and mat4 are backed by SSE registers whenever the compiler targets x86 with SSE2, which every x86-64 CPU has.
+// Define MATH_NO_SIMD to build the plain scalar versions instead. Both give bit-identical results,
+// except inverse(), where the two versions round differently.
+#if !defined(MATH_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define MATH_SIMD 1
+#include <emmintrin.h>
+#endif
+
+// Implementation inspired by Eric Lengyel's in Foundations of Game Engine Development Vol 1.
+// Aligned to 16 bytes so that a vec4 can be loaded into an SSE register with a single aligned load.
+class alignas(16) vec4
+{
+    public: 
+        vec4() = default;
+
+        vec4(float X, float Y, float Z, float W)
+            : x(X), y(Y), z(Z), w(W)
+        {
+        }
+
+#ifdef MATH_SIMD
+        explicit vec4(__m128 v)
+        {
+            _mm_store_ps(&x, v);
+        }
+
+        __m128 simd() const
+        {
+            return _mm_load_ps(&x);
+        }
+#endif
+
+        float& operator[](int i)
+        {
+            return ((&x)[i]);
+        }
+
+        const float& operator[](int i) const
+        {
+            return ((&x)[i]);
+        }
+
+        vec4& operator*=(float s)
+        {
+            return *this = *this * s;
+        }
+
+        vec4 operator*(float s) const
+        {
+#ifdef MATH_SIMD
+            return vec4(_mm_mul_ps(simd(), _mm_set1_ps(s)));
+#else
+            return vec4(x * s, y * s, z * s, w * s);
+#endif
+        }
+
+        vec4& operator/=(float s)
+        {
+            return *this = *this / s;
+        }
+
+        vec4 operator/(float s) const
+        {
+            return *this * (1.0f / s);
+        }
+
+        vec4& operator+=(const vec4& v)
+        {
+            return *this = *this + v;
+        }
+
+        vec4 operator+(const vec4& v) const
+        {
+#ifdef MATH_SIMD
+            return vec4(_mm_add_ps(simd(), v.simd()));
+#else
+            return vec4(x + v.x, y + v.y, z + v.z, w + v.w);
+#endif
+        }
+
+        vec4& operator-=(const vec4& v)
+        {
+            return *this = *this - v;
+        }
+
+        vec4 operator-(const vec4& v) const
+        {
+#ifdef MATH_SIMD
+            return vec4(_mm_sub_ps(simd(), v.simd()));
+#else
+            return vec4(x - v.x, y - v.y, z - v.z, w - v.w);
+#endif
+        }
+
+        void print() const
+        {
+            std::cout << "Vec4" << ": x = " << x << ", y = " << y << ", z = " << z << ", w = " << w << std::endl;
+        }
+
+        float x = 0;
+        float y = 0;
+        float z = 0;
+        float w = 0;
+};
+
+inline vec4 cross(const vec4& a, const vec4& b)
+{
+    return vec4((a.y * b.z - a.z * b.y),
+                (a.z * b.x - a.x * b.z), 
+                (a.x * b.y - a.y * b.x),
+                0);
 }
\ No newline at end of file
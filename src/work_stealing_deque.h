@@ -0,0 +1,99 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+// A fixed-capacity double-ended queue without locks, after Chase and Lev ("Dynamic Circular Work-Stealing Deque", 2005),
+// with the memory orderings of Lê, Pop, Cohen and Zappa Nardelli ("Correct and Efficient Work-Stealing for Weak Memory
+// Models", 2013). One thread, the owner, pushes and pops at the bottom, and any other thread may steal from the top.
+// The owner so gets back the item it pushed last, which is likely still in its cache, while thieves take the oldest,
+// which for work that is split recursively is the largest piece.
+//
+// Items are published to thieves by the standalone fences, which ThreadSanitizer does not model: it then reports every
+// stolen item as a race. Building with WORK_STEALING_DEQUE_TSAN (the JOB_SYSTEM_TSAN CMake option) stores the items and
+// bottom with release and loads the items with acquire as well, which is slower but lets TSan check the scheduler.
+template <typename T>
+class WorkStealingDeque
+{
+    static_assert(std::is_trivially_copyable<T>::value, "items are stored in atomics");
+
+#ifdef WORK_STEALING_DEQUE_TSAN
+    static constexpr std::memory_order PUBLISH_ORDER = std::memory_order_release;
+    static constexpr std::memory_order STEAL_ORDER = std::memory_order_acquire;
+#else
+    static constexpr std::memory_order PUBLISH_ORDER = std::memory_order_relaxed;
+    static constexpr std::memory_order STEAL_ORDER = std::memory_order_relaxed;
+#endif
+
+    public:
+        // The capacity is rounded up to a power of 2.
+        explicit WorkStealingDeque(size_t capacity)
+        {
+            size_t size = 1;
+            while (size < capacity) size *= 2;
+            items = std::make_unique<std::atomic<T>[]>(size);
+            mask = (int64_t) size - 1;
+        }
+
+        WorkStealingDeque(const WorkStealingDeque&) = delete;
+        WorkStealingDeque& operator=(const WorkStealingDeque&) = delete;
+
+        // Owner only. Returns false, leaving the deque alone, if it is full.
+        bool push(T item)
+        {
+            int64_t b = bottom.load(std::memory_order_relaxed);
+            int64_t t = top.load(std::memory_order_acquire);
+            if (b - t > mask) return false;
+
+            items[b & mask].store(item, PUBLISH_ORDER);
+            std::atomic_thread_fence(std::memory_order_release);
+            bottom.store(b + 1, PUBLISH_ORDER);
+            return true;
+        }
+
+        // Owner only. Takes the item pushed last, or returns false if there is none.
+        bool pop(T& item)
+        {
+            int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+            bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t t = top.load(std::memory_order_relaxed);
+
+            if (t > b)
+            {
+                bottom.store(b + 1, std::memory_order_relaxed);
+                return false;
+            }
+
+            item = items[b & mask].load(std::memory_order_relaxed);
+            if (t == b)
+            {
+                // The last item: thieves may be after it too, and whoever moves top first gets it.
+                bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+                bottom.store(b + 1, std::memory_order_relaxed);
+                return won;
+            }
+            return true;
+        }
+
+        // Any thread. Takes the oldest item, or returns false if there is none or another thread got to it first.
+        bool steal(T& item)
+        {
+            int64_t t = top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t b = bottom.load(std::memory_order_acquire);
+            if (t >= b) return false;
+
+            item = items[t & mask].load(STEAL_ORDER);
+            return top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        }
+
+    private:
+        // On separate cache lines, since thieves write top while the owner writes bottom.
+        alignas(64) std::atomic<int64_t> top{0};
+        alignas(64) std::atomic<int64_t> bottom{0};
+        std::unique_ptr<std::atomic<T>[]> items;
+        int64_t mask = 0;
+};
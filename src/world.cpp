@@ -1,41 +1,161 @@
-#include "world.h"
-
-void World::addObject(Object* object)
-{
-    objects.push_back(object);
-}
-
-std::vector<Object*>& World::getObjects()
-{
-    return objects;
-}
-
-void World::set_light(const vec3& l)
-{
-    light = l;
-}
-
-const vec3& World::get_light() const
-{
-    return light;
-}
-
-void World::set_eye(const vec3& e)
-{
-    eye = e;
-}
-
-const vec3& World::get_eye() const
-{
-    return eye;
-}
-
-void World::set_look_at_pt(const vec3& lk_at)
-{
-    look_at_pt = lk_at;
-}
-
-const vec3& World::get_look_at_pt() const
-{
-    return look_at_pt;
-}
+#include "world.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+// Moller-Trumbore: solves origin + t * direction = a + u * (b - a) + v * (c - a) for t, u and v by Cramer's rule.
+// Returns t, or infinity if the ray misses the triangle or hits it outside [0, max_distance].
+static float intersect_ray_triangle(const vec3& origin, const vec3& direction, const vec3& a, const vec3& b, const vec3& c, float max_distance)
+{
+    const float miss = std::numeric_limits<float>::infinity();
+    vec3 edge1 = b - a;
+    vec3 edge2 = c - a;
+    vec3 p = cross(direction, edge2);
+    float determinant = dot(edge1, p);
+    if (std::fabs(determinant) < 1e-12f) return miss; // The ray runs along the triangle's plane.
+
+    float inverse_determinant = 1 / determinant;
+    vec3 s = origin - a;
+    float u = dot(s, p) * inverse_determinant;
+    if (u < 0 || u > 1) return miss;
+
+    vec3 q = cross(s, edge1);
+    float v = dot(direction, q) * inverse_determinant;
+    if (v < 0 || u + v > 1) return miss;
+
+    float t = dot(edge2, q) * inverse_determinant;
+    return (t >= 0 && t <= max_distance) ? t : miss;
+}
+
+// The nearest hit on any triangle of the mesh, in the mesh's own space. direction doesn't have to be unit length,
+// and t is measured in multiples of it. Meshlets whose bounding spheres the ray passes by are skipped whole.
+static float intersect_ray_mesh(const Mesh& mesh, const vec3& origin, const vec3& direction, float max_distance)
+{
+    const VertexStreams& streams = mesh.getVertexStreams();
+    ArrayView<uint32_t> indices = mesh.getIndices();
+    auto position = [&streams](uint32_t i) { return vec3(streams.x[i], streams.y[i], streams.z[i]); };
+
+    float nearest = std::numeric_limits<float>::infinity();
+    auto intersect_triangles = [&](size_t begin, size_t end)
+    {
+        for (size_t i = begin * 3; i < end * 3; i += 3)
+        {
+            float t = intersect_ray_triangle(origin, direction, position(indices[i]), position(indices[i + 1]), position(indices[i + 2]),
+                                             std::min(nearest, max_distance));
+            nearest = std::min(nearest, t);
+        }
+    };
+
+    ArrayView<Meshlet> meshlets = mesh.getMeshlets();
+    if (meshlets.size() == 0)
+    {
+        intersect_triangles(0, mesh.getTriangleCount());
+        return nearest;
+    }
+
+    float direction_length_squared = dot(direction, direction);
+    for (const Meshlet& meshlet : meshlets)
+    {
+        // The point on the ray's line closest to the sphere's center.
+        vec3 to_center = meshlet.center - origin;
+        float t = dot(to_center, direction) / direction_length_squared;
+        vec3 offset = to_center - (direction * t);
+        if (dot(offset, offset) > meshlet.radius * meshlet.radius) continue;
+
+        intersect_triangles(meshlet.triangle_offset, meshlet.triangle_offset + meshlet.triangle_count);
+    }
+    return nearest;
+}
+
+void World::addObject(Object* object)
+{
+    objects.push_back(object);
+    leaves[object] = bvh.insert(object->getWorldBounds(), object);
+}
+
+void World::removeObject(Object* object)
+{
+    auto leaf = leaves.find(object);
+    if (leaf == leaves.end()) return;
+
+    bvh.remove(leaf->second);
+    leaves.erase(leaf);
+    objects.erase(std::find(objects.begin(), objects.end(), object));
+}
+
+void World::updateObject(Object* object)
+{
+    auto leaf = leaves.find(object);
+    if (leaf == leaves.end()) return;
+
+    bvh.update(leaf->second, object->getWorldBounds());
+}
+
+const std::vector<Object*>& World::getObjects() const
+{
+    return objects;
+}
+
+void World::queryObjects(const FrustumPlanes& frustum, const vec3& eye, std::vector<Object*>& visible,
+                         const std::function<bool(const AABB&)>& occluded) const
+{
+    bvh.query(frustum, eye, visible, occluded);
+}
+
+// The ray is carried into each candidate's object space, where an affine transform keeps t the same.
+Object* World::pickObject(const vec3& origin, const vec3& direction, float& distance) const
+{
+    auto hit = [&origin, &direction](Object* object, float nearest)
+    {
+        mat4 inverse_model = inverse(*object->getMat());
+        vec3 local_origin = vec3(inverse_model * vec4(origin.x, origin.y, origin.z, 1));
+        vec3 local_direction = vec3(inverse_model * vec4(direction.x, direction.y, direction.z, 0));
+        return intersect_ray_mesh(*object->getMesh(), local_origin, local_direction, nearest);
+    };
+    return bvh.ray_cast(origin, direction, std::numeric_limits<float>::max(), hit, distance);
+}
+
+const BVH& World::getBVH() const
+{
+    return bvh;
+}
+
+void World::addInstances(InstancedObject* instanced_object)
+{
+    instances.push_back(instanced_object);
+}
+
+const std::vector<InstancedObject*>& World::getInstances() const
+{
+    return instances;
+}
+
+void World::set_light(const vec3& l)
+{
+    light = l;
+}
+
+const vec3& World::get_light() const
+{
+    return light;
+}
+
+void World::set_eye(const vec3& e)
+{
+    eye = e;
+}
+
+const vec3& World::get_eye() const
+{
+    return eye;
+}
+
+void World::set_look_at_pt(const vec3& lk_at)
+{
+    look_at_pt = lk_at;
+}
+
+const vec3& World::get_look_at_pt() const
+{
+    return look_at_pt;
+}
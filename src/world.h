@@ -1,34 +1,65 @@
-#pragma once
-#include "object.h"
-#include "mesh.h"
-#include "mat4.h"
-
-class World
-{
-    public:
-        World() = default;
-
-        void addObject(Object* object);
-        std::vector<Object*>& getObjects();
-        
-        void set_light(const vec3& l);
-        const vec3& get_light() const;
-
-        void set_eye(const vec3& e);
-        const vec3& get_eye() const;
-
-        void set_look_at_pt(const vec3& lk_at);
-        const vec3& get_look_at_pt() const;
-    private:
-        std::vector<Object*> objects;
-
-        vec3 light;
-        vec3 eye;
-        vec3 look_at_pt;
-        float t = 1.0f;
-        float b = -t;
-        float r = 1.0f;
-        float l = -r;
-        float n = 1.8f;
-        float f = 10.0f;
-};
+#pragma once
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include "object.h"
+#include "instanced_object.h"
+#include "mesh.h"
+#include "mat4.h"
+#include "bvh.h"
+
+struct FrustumPlanes;
+
+class World
+{
+    public:
+        World() = default;
+
+        // Objects are kept in a BVH by their world-space bounds, so call updateObject after changing an object's
+        // matrix or mesh. Until then, queries go by where the object was. Removing an object is linear in their number.
+        void addObject(Object* object);
+        void removeObject(Object* object);
+        void updateObject(Object* object);
+        // In the order they were added.
+        const std::vector<Object*>& getObjects() const;
+
+        // Appends the objects whose bounds may reach into the frustum, roughly nearest to eye first.
+        // Nodes of the BVH that occluded says are hidden are skipped with all the objects under them; see BVH::query.
+        void queryObjects(const FrustumPlanes& frustum, const vec3& eye, std::vector<Object*>& visible,
+                          const std::function<bool(const AABB&)>& occluded = nullptr) const;
+
+        // The object whose triangles the ray origin + t * direction hits first, for t >= 0, or nullptr if there is none.
+        // distance is set to t at the hit. Triangles count whichever way they face.
+        Object* pickObject(const vec3& origin, const vec3& direction, float& distance) const;
+
+        const BVH& getBVH() const;
+
+        // Instanced objects aren't in the BVH: the renderer culls their copies one by one, which is cheap for
+        // the numbers that are worth drawing at all, and keeps the copies free to move without updating anything.
+        void addInstances(InstancedObject* instanced_object);
+        const std::vector<InstancedObject*>& getInstances() const;
+        
+        void set_light(const vec3& l);
+        const vec3& get_light() const;
+
+        void set_eye(const vec3& e);
+        const vec3& get_eye() const;
+
+        void set_look_at_pt(const vec3& lk_at);
+        const vec3& get_look_at_pt() const;
+    private:
+        std::vector<Object*> objects;
+        BVH bvh;
+        std::unordered_map<Object*, int> leaves; // The BVH leaf of each object.
+        std::vector<InstancedObject*> instances;
+
+        vec3 light;
+        vec3 eye;
+        vec3 look_at_pt;
+        float t = 0.1f;
+        float b = -t;
+        float r = 0.1f;
+        float l = -r;
+        float n = 0.18f;
+        float f = 10.0f;
+};
@@ -0,0 +1,113 @@
+// Measures what the job system costs per job: spawning from outside the workers and from inside a job, a parallel_for
+// over as many tasks as an 800x800 frame has tiles, and how long a queued job waits before another worker steals it.
+// "job_system_benchmark [threads...]" runs it for each thread count, 1, 2 and 4 by default.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+#include "thread_pool.h"
+
+namespace
+{
+    constexpr int SPAWN_JOBS = 1000000;
+    constexpr int PARALLEL_FOR_CALLS = 20000;
+    constexpr int STEAL_SAMPLES = 2000;
+
+    double nanoseconds_since(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    void benchmark_spawn(ThreadPool& pool)
+    {
+        std::atomic<int> runs{0};
+
+        // From this thread, which isn't a worker, so through the shared queue.
+        JobCounter outside;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < SPAWN_JOBS; i++)
+        {
+            pool.spawn(outside, [&] { runs.fetch_add(1, std::memory_order_relaxed); });
+        }
+        double spawn_ns = nanoseconds_since(start);
+        pool.wait(outside);
+        double total_ns = nanoseconds_since(start);
+        std::printf("  spawn from outside: %.0f ns per job, %.0f ns with running it\n", spawn_ns / SPAWN_JOBS, total_ns / SPAWN_JOBS);
+
+        // From a job, so onto that worker's own deque.
+        JobCounter inside;
+        start = std::chrono::steady_clock::now();
+        pool.spawn(inside, [&]
+        {
+            for (int i = 0; i < SPAWN_JOBS; i++)
+            {
+                pool.spawn(inside, [&] { runs.fetch_add(1, std::memory_order_relaxed); });
+            }
+        });
+        pool.wait(inside);
+        std::printf("  spawn from a job: %.0f ns per job with running it\n", nanoseconds_since(start) / SPAWN_JOBS);
+    }
+
+    void benchmark_parallel_for(ThreadPool& pool)
+    {
+        std::atomic<int> runs{0};
+        auto start = std::chrono::steady_clock::now();
+        for (int call = 0; call < PARALLEL_FOR_CALLS; call++)
+        {
+            pool.parallel_for(169, [&](int) { runs.fetch_add(1, std::memory_order_relaxed); });
+        }
+        std::printf("  parallel_for(169): %.2f us per call\n", nanoseconds_since(start) / 1000 / PARALLEL_FOR_CALLS);
+    }
+
+    // A job spawns a child and then spins, so the child can only run once another thread steals it.
+    void benchmark_steal_latency(ThreadPool& pool)
+    {
+        using clock = std::chrono::steady_clock;
+        std::vector<double> latencies;
+        for (int sample = 0; sample < STEAL_SAMPLES; sample++)
+        {
+            JobCounter counter;
+            std::atomic<bool> stolen{false};
+            clock::time_point pushed;
+            clock::time_point started;
+            pool.spawn(counter, [&]
+            {
+                pushed = clock::now();
+                pool.spawn(counter, [&]
+                {
+                    started = clock::now();
+                    stolen = true;
+                });
+                auto give_up = clock::now() + std::chrono::milliseconds(2);
+                while (!stolen.load() && clock::now() < give_up) {}
+            });
+            pool.wait(counter);
+            latencies.push_back(std::chrono::duration<double, std::micro>(started - pushed).count());
+        }
+        std::sort(latencies.begin(), latencies.end());
+        std::printf("  steal latency: median %.1f us, 90th percentile %.1f us\n", latencies[STEAL_SAMPLES / 2],
+                    latencies[STEAL_SAMPLES * 9 / 10]);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::vector<unsigned int> thread_counts;
+    for (int i = 1; i < argc; i++)
+    {
+        thread_counts.push_back((unsigned int) std::atoi(argv[i]));
+    }
+    if (thread_counts.empty()) thread_counts = {1, 2, 4};
+
+    for (unsigned int threads : thread_counts)
+    {
+        ThreadPool pool(threads);
+        std::printf("%d threads\n", pool.size());
+        benchmark_spawn(pool);
+        benchmark_parallel_for(pool);
+        if (pool.size() > 1) benchmark_steal_latency(pool);
+    }
+    return 0;
+}
@@ -0,0 +1,195 @@
+// Checks the work-stealing deque and the thread pool under contention. Run by ctest; build with the JOB_SYSTEM_TSAN
+// option to have ThreadSanitizer check it as well.
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+#include "thread_pool.h"
+#include "work_stealing_deque.h"
+
+#define CHECK(condition)                                                                  \
+    do                                                                                    \
+    {                                                                                     \
+        if (!(condition))                                                                 \
+        {                                                                                 \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            std::exit(1);                                                                 \
+        }                                                                                 \
+    } while (0)
+
+namespace
+{
+    void test_deque_order()
+    {
+        WorkStealingDeque<int> deque(4);
+        int item;
+        CHECK(!deque.pop(item));
+        CHECK(!deque.steal(item));
+        for (int i = 0; i < 4; i++)
+        {
+            CHECK(deque.push(i));
+        }
+        CHECK(!deque.push(4));
+
+        // The owner takes the newest item, thieves the oldest.
+        CHECK(deque.steal(item) && item == 0);
+        CHECK(deque.pop(item) && item == 3);
+        CHECK(deque.pop(item) && item == 2);
+        CHECK(deque.push(5) && deque.push(6));
+        CHECK(deque.steal(item) && item == 1);
+        CHECK(deque.steal(item) && item == 5);
+        CHECK(deque.pop(item) && item == 6);
+        CHECK(!deque.pop(item));
+        CHECK(!deque.steal(item));
+    }
+
+    // The owner pushes a few items and pops one at a time while the thieves steal; every item must be taken exactly
+    // once, including the last ones, which the owner and a thief race for.
+    void test_deque_owner_against_thieves(int thieves, int count)
+    {
+        WorkStealingDeque<int> deque(256);
+        std::vector<std::atomic<int>> taken(count);
+        std::atomic<bool> done{false};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < thieves; t++)
+        {
+            threads.emplace_back([&]
+            {
+                int item;
+                while (!done.load())
+                {
+                    if (deque.steal(item)) taken[item]++;
+                }
+            });
+        }
+
+        int pushed = 0;
+        int item;
+        while (pushed < count)
+        {
+            for (int i = 0; i < 3 && pushed < count && deque.push(pushed); i++)
+            {
+                pushed++;
+            }
+            if (deque.pop(item)) taken[item]++;
+        }
+        while (deque.pop(item))
+        {
+            taken[item]++;
+        }
+        done = true;
+        for (std::thread& thread : threads)
+        {
+            thread.join();
+        }
+        while (deque.steal(item))
+        {
+            taken[item]++;
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            CHECK(taken[i] == 1);
+        }
+    }
+
+    // A job that spawns fanout children under the same counter, down to the given depth.
+    void spawn_tree(ThreadPool& pool, JobCounter& counter, std::atomic<int>& jobs, int depth, int fanout)
+    {
+        jobs++;
+        if (depth == 0) return;
+        for (int i = 0; i < fanout; i++)
+        {
+            pool.spawn(counter, [&pool, &counter, &jobs, depth, fanout] { spawn_tree(pool, counter, jobs, depth - 1, fanout); });
+        }
+    }
+
+    // The counter may only reach zero once every job of the tree has run, however deep they were spawned.
+    void test_nested_spawn_trees(ThreadPool& pool)
+    {
+        const int depth = 7;
+        const int fanout = 4;
+        const int expected = ((1 << (2 * (depth + 1))) - 1) / 3; // 1 + 4 + ... + 4^depth
+        for (int repeat = 0; repeat < 5; repeat++)
+        {
+            std::atomic<int> jobs{0};
+            JobCounter counter;
+            pool.spawn(counter, [&] { spawn_tree(pool, counter, jobs, depth, fanout); });
+            pool.wait(counter);
+            CHECK(jobs == expected);
+        }
+    }
+
+    void test_parallel_for(ThreadPool& pool)
+    {
+        for (int count : {0, 1, 2, 3, 169, 1000, 100000})
+        {
+            std::vector<std::atomic<int>> runs(count);
+            pool.parallel_for(count, [&](int i) { runs[i]++; });
+            for (int i = 0; i < count; i++)
+            {
+                CHECK(runs[i] == 1);
+            }
+        }
+    }
+
+    // Every outer task waits for an inner parallel_for, on workers and the calling thread alike.
+    void test_nested_parallel_for(ThreadPool& pool)
+    {
+        std::atomic<long> sum{0};
+        pool.parallel_for(64, [&](int i)
+        {
+            pool.parallel_for(64, [&](int j) { sum += i * 64 + j; });
+        });
+        CHECK(sum == 4096L * 4095 / 2);
+    }
+
+    // Threads that aren't workers spawn into the shared queue, several at once, each waiting on its own counters.
+    void test_spawn_from_outside(ThreadPool& pool)
+    {
+        const int threads = 4;
+        const int rounds = 50;
+        const int jobs = 100;
+        std::atomic<int> runs{0};
+        std::vector<std::thread> outside;
+        for (int t = 0; t < threads; t++)
+        {
+            outside.emplace_back([&]
+            {
+                for (int round = 0; round < rounds; round++)
+                {
+                    JobCounter counter;
+                    for (int i = 0; i < jobs; i++)
+                    {
+                        pool.spawn(counter, [&] { runs++; });
+                    }
+                    pool.wait(counter);
+                }
+            });
+        }
+        for (std::thread& thread : outside)
+        {
+            thread.join();
+        }
+        CHECK(runs == threads * rounds * jobs);
+    }
+}
+
+int main()
+{
+    test_deque_order();
+    test_deque_owner_against_thieves(3, 1000000);
+    std::printf("deque ok\n");
+
+    for (unsigned int threads : {1, 2, 4, 8})
+    {
+        ThreadPool pool(threads);
+        test_nested_spawn_trees(pool);
+        test_parallel_for(pool);
+        test_nested_parallel_for(pool);
+        test_spawn_from_outside(pool);
+        std::printf("pool ok with %d threads\n", pool.size());
+    }
+    return 0;
+}
@@ -0,0 +1,103 @@
+// Renders the same camera path with 1, 2 and 3 frames in flight, resizing the window halfway through, and checks that
+// every frame that comes back has the size and format of the window and the same pixels as without pipelining.
+// Run by ctest from the build directory, where CMake copies obj/ and img/.
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <map>
+#include <memory>
+#include <vector>
+#include "frame.h"
+#include "mat4.h"
+#include "mesh.h"
+#include "object.h"
+#include "renderer.h"
+#include "texture.h"
+#include "world.h"
+#include "shaders/phong_shader.h"
+
+#define CHECK(condition)                                                                  \
+    do                                                                                    \
+    {                                                                                     \
+        if (!(condition))                                                                 \
+        {                                                                                 \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            std::exit(1);                                                                 \
+        }                                                                                 \
+    } while (0)
+
+namespace
+{
+    constexpr int SIZE = 200;
+    // Not a multiple of the tile size, and with a different number of tiles across than down.
+    constexpr int RESIZED_W = 150;
+    constexpr int RESIZED_H = 90;
+    constexpr int CALLS = 6; // Calls to render() before the window is resized, and after.
+
+    uint64_t hash_pixels(const Frame& frame)
+    {
+        uint64_t hash = 1469598103934665603ULL;
+        for (int i = 0; i < frame.w * frame.h; i++)
+        {
+            hash = (hash ^ frame.buffer[i]) * 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    // The hashes of the frames the renderer hands back, by the number of the call that recorded them. The frames still
+    // in flight when the window changes size are dropped, so a deeper pipeline hands back fewer of them.
+    std::map<int, uint64_t> render_frames(int pipeline_depth)
+    {
+        Frame frame(SIZE, SIZE, SDL_AllocFormat(SDL_PIXELFORMAT_ARGB8888));
+        auto texture = std::make_shared<Texture>("img/african_head_diffuse.tga");
+        Object head(std::make_shared<Mesh>("obj/african_head.obj", texture), std::make_unique<mat4>(makeTranslation(0, 0, 0)));
+        World world;
+        world.addObject(&head);
+        PhongShader shader(world, frame);
+        Renderer renderer(world, frame, shader);
+        renderer.set_pipeline_depth(pipeline_depth);
+
+        std::map<int, uint64_t> hashes;
+        std::deque<int> in_flight;
+        for (int i = 0; i < 2 * CALLS; i++)
+        {
+            if (i == CALLS)
+            {
+                frame = Frame(RESIZED_W, RESIZED_H, frame.pixel_format);
+                in_flight.clear();
+            }
+
+            double angle = i * 0.7;
+            world.set_eye(vec3(std::cos(angle) * 2, 1, std::sin(angle) * 2));
+            in_flight.push_back(i);
+            Frame* rendered = renderer.render();
+            if (rendered == nullptr) continue; // The pipeline is still filling up.
+
+            CHECK(rendered->w == frame.w);
+            CHECK(rendered->h == frame.h);
+            CHECK(rendered->pixel_format == frame.pixel_format);
+            hashes[in_flight.front()] = hash_pixels(*rendered);
+            in_flight.pop_front();
+        }
+        return hashes;
+    }
+}
+
+int main()
+{
+    std::map<int, uint64_t> expected = render_frames(1);
+    CHECK((int) expected.size() == 2 * CALLS);
+    for (int depth = 2; depth <= 3; depth++)
+    {
+        std::map<int, uint64_t> hashes = render_frames(depth);
+        CHECK((int) hashes.size() == 2 * (CALLS - (depth - 1)));
+        for (const auto& [call, hash] : hashes)
+        {
+            CHECK(hash == expected[call]);
+        }
+        std::printf("pipeline depth %d ok\n", depth);
+    }
+    return 0;
+}